@@ -0,0 +1,93 @@
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/time.hpp>
+#include <eosio/system.hpp>
+
+namespace tychefi {
+
+/**
+ * Bounded work for loops whose length grows with table size.
+ *
+ * A loop charges each item against a work_budget and stops once the budget
+ * is spent, instead of running into the transaction CPU limit. Where it
+ * stopped is kept in a continuation row, and calling the owning action
+ * again resumes from there; the row is erased once the loop reaches the end.
+ *
+ * Loops that cannot be split across transactions (e.g. shares that must be
+ * summed before anything is distributed) keep a hard cap on the table
+ * instead.
+ */
+class work_budget {
+   public:
+      explicit work_budget( const uint32_t& limit ): _left(limit) {}
+
+      //扣减 units, 余量不足时返回 false; 第一项总是执行, 保证每次调用都有进展
+      bool spend( const uint32_t& units = 1 ) {
+         if( _used > 0 && units > _left ) {
+            _exhausted  = true;
+            return false;
+         }
+         _left          = units > _left ? 0 : _left - units;
+         _used          += units;
+         return true;
+      }
+
+      bool exhausted()const { return _exhausted; }
+      uint32_t used()const { return _used; }
+
+   private:
+      uint32_t    _left;
+      uint32_t    _used       = 0;
+      bool        _exhausted  = false;
+};
+
+/**
+ * Continuation cursor over a contract table whose rows have
+ *    name task (PK), uint64_t tag, uint64_t next_key, time_point_sec updated_at
+ * One row per (scope, task). tag holds the task's argument: a cursor saved
+ * for a different tag is ignored and overwritten, so resuming never skips
+ * keys of another call.
+ */
+template<typename Table>
+class continuation {
+   public:
+      continuation( const eosio::name& code, const uint64_t& scope, const eosio::name& task, const uint64_t& tag = 0 ):
+         _tbl(code, scope), _task(task), _tag(tag), _itr(_tbl.find(task.value)) {}
+
+      //有同一 tag 的未完成进度
+      bool pending()const { return _itr != _tbl.end() && _itr->tag == _tag; }
+
+      //续跑起点, 无进度时为 0
+      uint64_t next_key()const { return pending() ? _itr->next_key : 0; }
+
+      //预算用尽: 记录下一次的起点
+      void save( const uint64_t& next_key, const eosio::name& payer ) {
+         auto set_row   = [&]( auto& c ) {
+            c.task         = _task;
+            c.tag          = _tag;
+            c.next_key     = next_key;
+            c.updated_at   = eosio::current_time_point();
+         };
+         if( _itr == _tbl.end() )
+            _itr = _tbl.emplace( payer, set_row );
+         else
+            _tbl.modify( _itr, eosio::same_payer, set_row );
+      }
+
+      //已处理到末尾: 删除进度
+      void finish() {
+         if( _itr == _tbl.end() ) return;
+         _tbl.erase( _itr );
+         _itr = _tbl.end();
+      }
+
+   private:
+      Table                            _tbl;
+      eosio::name                      _task;
+      uint64_t                         _tag;
+      typename Table::const_iterator   _itr;
+};
+
+} //namespace tychefi
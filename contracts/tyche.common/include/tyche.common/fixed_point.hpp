@@ -0,0 +1,169 @@
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace tychefi {
+
+/**
+ * Fixed-point helpers shared by tyche.earn / tyche.loan / tyche.market.
+ *
+ * - pow10 values come from a constexpr table (10^0 .. 10^38) instead of a
+ *   runtime loop or <cmath>.
+ * - mul_div(a, b, c) computes a * b / c with a 256-bit intermediate, so the
+ *   product never wraps; only a quotient outside int128 aborts.
+ * - Rounding is always explicit: down (toward zero, same as C++ integer
+ *   division), up (away from zero), half_up (half away from zero).
+ * - fixed<Scale> is a value scaled by 10^Scale at compile time, e.g.
+ *   fixed<18> for HIGH_PRECISION indexes.
+ */
+
+enum class rounding: uint8_t {
+   down     = 0,     //向零截断
+   up       = 1,     //远离零进位
+   half_up  = 2      //四舍五入(远离零)
+};
+
+namespace detail {
+   constexpr std::array<uint128_t, 39> make_pow10_table() {
+      std::array<uint128_t, 39> table{};
+      table[0] = 1;
+      for( size_t i = 1; i < table.size(); i++ )
+         table[i] = table[i - 1] * 10;
+      return table;
+   }
+
+   //|v|, 对 int128 最小值同样成立
+   constexpr uint128_t abs_u128( int128_t v ) {
+      return v < 0 ? uint128_t(0) - uint128_t(v) : uint128_t(v);
+   }
+} //namespace detail
+
+inline constexpr std::array<uint128_t, 39> POW10 = detail::make_pow10_table();
+
+//编译期 10^N, N > 38 时编译失败
+template<uint8_t N>
+inline constexpr int128_t pow10_v = int128_t(POW10.at(N));
+
+inline int128_t pow10_i128( uint8_t exp ) {
+   eosio::check( exp <= 38, "pow10 exponent out of range" );
+   return int128_t(POW10[exp]);
+}
+
+inline int64_t pow10_i64( uint8_t exp ) {
+   eosio::check( exp <= 18, "pow10 exponent out of range" );
+   return int64_t(POW10[exp]);
+}
+
+static constexpr int128_t HIGH_PRECISION = int128_t(POW10[18]);    // 10^18
+
+/**
+ * Unsigned a * b / c with a full 256-bit product.
+ * Aborts when c is 0 or the quotient does not fit in 128 bits.
+ */
+inline uint128_t mul_div_u( uint128_t a, uint128_t b, uint128_t c, rounding mode = rounding::down ) {
+   eosio::check( c != 0, "mul_div: divide by zero" );
+
+   //128 x 128 -> 256: (hi, lo)
+   constexpr uint128_t MASK = std::numeric_limits<uint64_t>::max();
+   uint128_t a0 = a & MASK, a1 = a >> 64;
+   uint128_t b0 = b & MASK, b1 = b >> 64;
+   uint128_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+   uint128_t mid = (p00 >> 64) + (p01 & MASK) + (p10 & MASK);
+   uint128_t lo  = (p00 & MASK) | (mid << 64);
+   uint128_t hi  = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+
+   uint128_t q, r;
+   if( hi == 0 ) {
+      q = lo / c;
+      r = lo % c;
+   } else {
+      eosio::check( hi < c, "mul_div: overflow" );
+      //高位非零时按位长除, 余数始终 < c
+      q = 0;
+      r = hi;
+      for( int i = 127; i >= 0; i-- ) {
+         bool carry  = (r >> 127) != 0;
+         r           = (r << 1) | ((lo >> i) & 1);
+         q           <<= 1;
+         if( carry || r >= c ) {
+            r        -= c;
+            q        |= 1;
+         }
+      }
+   }
+
+   bool bump = false;
+   switch( mode ) {
+      case rounding::down:    break;
+      case rounding::up:      bump = r != 0; break;
+      case rounding::half_up: bump = r != 0 && r >= c - r; break;
+   }
+   if( bump ) {
+      eosio::check( q != std::numeric_limits<uint128_t>::max(), "mul_div: overflow" );
+      q++;
+   }
+   return q;
+}
+
+//有符号 a * b / c, 舍入方向按绝对值计算
+inline int128_t mul_div( int128_t a, int128_t b, int128_t c, rounding mode = rounding::down ) {
+   bool negative = (a < 0) != (b < 0);
+   if( c < 0 ) negative = !negative;
+   uint128_t q = mul_div_u( detail::abs_u128(a), detail::abs_u128(b), detail::abs_u128(c), mode );
+   constexpr uint128_t MAX = uint128_t(std::numeric_limits<int128_t>::max());
+   eosio::check( q <= (negative ? MAX + 1 : MAX), "mul_div: overflow" );
+   return negative ? int128_t(uint128_t(0) - q) : int128_t(q);
+}
+
+/**
+ * Value scaled by 10^Scale. raw is the stored integer; one is 1.0.
+ * Not serialized: table fields keep their plain integer types.
+ */
+template<uint8_t Scale>
+struct fixed {
+   static_assert( Scale <= 38, "fixed scale out of range" );
+   static constexpr int128_t one = int128_t(POW10[Scale]);
+
+   int128_t raw = 0;
+
+   static constexpr fixed from_raw( int128_t raw ) { return fixed{ raw }; }
+
+   //num / den
+   static fixed from_ratio( int128_t num, int128_t den, rounding mode = rounding::down ) {
+      return fixed{ mul_div( num, one, den, mode ) };
+   }
+
+   //amount * value
+   int128_t times( int128_t amount, rounding mode = rounding::down )const {
+      return mul_div( amount, raw, one, mode );
+   }
+
+   //amount / value
+   int128_t divide( int128_t amount, rounding mode = rounding::down )const {
+      return mul_div( amount, one, raw, mode );
+   }
+
+   template<uint8_t To>
+   fixed<To> rescale( rounding mode = rounding::down )const {
+      if constexpr( To >= Scale ) return fixed<To>{ mul_div( raw, int128_t(POW10[To - Scale]), 1 ) };
+      else                        return fixed<To>{ mul_div( raw, 1, int128_t(POW10[Scale - To]), mode ) };
+   }
+
+   friend constexpr fixed operator+( fixed a, fixed b )  { return fixed{ a.raw + b.raw }; }
+   friend constexpr fixed operator-( fixed a, fixed b )  { return fixed{ a.raw - b.raw }; }
+   friend constexpr bool operator==( fixed a, fixed b )  { return a.raw == b.raw; }
+   friend constexpr bool operator!=( fixed a, fixed b )  { return a.raw != b.raw; }
+   friend constexpr bool operator<( fixed a, fixed b )   { return a.raw < b.raw; }
+   friend constexpr bool operator<=( fixed a, fixed b )  { return a.raw <= b.raw; }
+   friend constexpr bool operator>( fixed a, fixed b )   { return a.raw > b.raw; }
+   friend constexpr bool operator>=( fixed a, fixed b )  { return a.raw >= b.raw; }
+};
+
+//HIGH_PRECISION 定点
+using wad = fixed<18>;
+
+} //namespace tychefi
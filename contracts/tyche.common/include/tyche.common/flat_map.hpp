@@ -0,0 +1,165 @@
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace wasm {
+
+/**
+ * Sorted-vector map for small row-embedded maps.
+ *
+ * Serialized exactly like std::map<K, V> (varuint32 size followed by key/value
+ * pairs in ascending key order), so it can replace a std::map field in an
+ * existing table without migrating the rows. Decoding reserves once and
+ * appends, instead of allocating one tree node per entry; lookups are a
+ * binary search over contiguous storage.
+ *
+ * Insertion shifts the tail and invalidates iterators and references, the
+ * same as std::vector. Keys must not be modified through iterators.
+ *
+ * The class template is named `map` on purpose: abigen recognizes map
+ * specializations by template name and emits them as `pair_K_V[]`, the
+ * same ABI type it emits for std::map. Under any other name it would
+ * describe the private `items` member as a struct, and get_table would
+ * wrap every map as {"items": [...]}. Use it through the wasm::flat_map
+ * alias.
+ */
+namespace flat {
+
+template<typename K, typename V>
+class map {
+public:
+    using key_type          = K;
+    using mapped_type       = V;
+    using value_type        = std::pair<K, V>;
+    using container_type    = std::vector<value_type>;
+    using iterator          = typename container_type::iterator;
+    using const_iterator    = typename container_type::const_iterator;
+    using size_type         = typename container_type::size_type;
+
+    map() {}
+
+    iterator begin()                { return items.begin(); }
+    iterator end()                  { return items.end(); }
+    const_iterator begin()const     { return items.begin(); }
+    const_iterator end()const       { return items.end(); }
+
+    size_type size()const           { return items.size(); }
+    bool empty()const               { return items.empty(); }
+    void reserve(size_type n)       { items.reserve(n); }
+    void clear()                    { items.clear(); }
+
+    iterator lower_bound(const K& key) {
+        return std::lower_bound(items.begin(), items.end(), key, key_less);
+    }
+    const_iterator lower_bound(const K& key)const {
+        return std::lower_bound(items.begin(), items.end(), key, key_less);
+    }
+
+    iterator find(const K& key) {
+        auto itr = lower_bound(key);
+        return (itr != items.end() && itr->first == key) ? itr : items.end();
+    }
+    const_iterator find(const K& key)const {
+        auto itr = lower_bound(key);
+        return (itr != items.end() && itr->first == key) ? itr : items.end();
+    }
+
+    size_type count(const K& key)const { return find(key) != items.end() ? 1 : 0; }
+
+    V& at(const K& key) {
+        auto itr = find(key);
+        eosio::check(itr != items.end(), "flat_map::at: key not found");
+        return itr->second;
+    }
+    const V& at(const K& key)const {
+        auto itr = find(key);
+        eosio::check(itr != items.end(), "flat_map::at: key not found");
+        return itr->second;
+    }
+
+    V& operator[](const K& key) {
+        return try_emplace(key).first->second;
+    }
+
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        auto itr = lower_bound(key);
+        if (itr != items.end() && itr->first == key)
+            return { itr, false };
+        itr = items.emplace(itr, std::piecewise_construct, std::forward_as_tuple(key),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+        return { itr, true };
+    }
+
+    template<typename M>
+    std::pair<iterator, bool> emplace(const K& key, M&& value) {
+        return try_emplace(key, std::forward<M>(value));
+    }
+
+    iterator erase(const_iterator pos)  { return items.erase(pos); }
+
+    size_type erase(const K& key) {
+        auto itr = find(key);
+        if (itr == items.end()) return 0;
+        items.erase(itr);
+        return 1;
+    }
+
+    template<typename Pred>
+    size_type erase_if(Pred&& pred) {
+        auto first = std::remove_if(items.begin(), items.end(), std::forward<Pred>(pred));
+        auto n     = size_type(items.end() - first);
+        items.erase(first, items.end());
+        return n;
+    }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const map& m) {
+        ds << eosio::unsigned_int(m.items.size());
+        for (const auto& kv : m.items) {
+            ds << kv.first;
+            ds << kv.second;
+        }
+        return ds;
+    }
+
+    template<typename DataStream>
+    friend DataStream& operator>>(DataStream& ds, map& m) {
+        eosio::unsigned_int s;
+        ds >> s;
+        m.items.clear();
+        m.items.resize(s.value);
+        bool sorted = true;
+        for (size_type i = 0; i < s.value; ++i) {
+            ds >> m.items[i].first;
+            ds >> m.items[i].second;
+            if (i > 0 && !(m.items[i - 1].first < m.items[i].first)) sorted = false;
+        }
+        //std::map 写入的数据天然有序, 仅兜底
+        if (!sorted) {
+            std::stable_sort(m.items.begin(), m.items.end(),
+                             [](const value_type& a, const value_type& b) { return a.first < b.first; });
+            m.items.erase(std::unique(m.items.begin(), m.items.end(),
+                                      [](const value_type& a, const value_type& b) { return a.first == b.first; }),
+                          m.items.end());
+        }
+        return ds;
+    }
+
+private:
+    static bool key_less(const value_type& kv, const K& key) { return kv.first < key; }
+
+    container_type items;
+};
+
+} //namespace flat
+
+template<typename K, typename V>
+using flat_map = flat::map<K, V>;
+
+} //namespace wasm
@@ -4,6 +4,7 @@
 #include <eosio/eosio.hpp>
 
 #include <string>
+#include <vector>
 
 namespace eosiosystem {
    class system_contract;
@@ -18,9 +19,11 @@ static constexpr eosio::name active_perm{"active"_n};
     {	flon::token::burn_action act{ bank, { {_self, active_perm} } };\
 			act.send( from, quantity, memo );}
 
+//存在 flon::transfer_batch 时先汇总, 否则立即发出
 #define TRANSFER(bank, to, quantity, memo) \
-    {	flon::token::transfer_action act{ bank, { {_self, active_perm} } };\
-			act.send( _self, to, quantity , memo );}
+    {	if( auto batch = flon::transfer_batch::current() ) batch->add( bank, to, quantity, memo );\
+		else { flon::token::transfer_action act{ bank, { {_self, active_perm} } };\
+			act.send( _self, to, quantity , memo );} }
 
 namespace flon {
    using namespace eosio;
@@ -172,4 +175,74 @@ namespace flon {
          void add_balance( const name& owner, const asset& value, const name& ram_payer );
    };
 
+   /**
+    * Opt-in payout collector for TRANSFER.
+    *
+    * While a transfer_batch is alive, TRANSFER adds to it instead of sending.
+    * Transfers with the same (bank, to, symbol) are summed, and their distinct
+    * memos are joined with "|". send() or the destructor emits one inline
+    * transfer per key, in first-seen order. A merged memo stays within the
+    * token's 256-byte limit: a transfer whose memo would overflow it opens a
+    * new entry for the same key. Batches nest; the innermost one collects.
+    */
+   class transfer_batch {
+      public:
+         explicit transfer_batch( const name& self ): _self(self), _prev(_current) { _current = this; }
+         ~transfer_batch() {
+            send();
+            _current = _prev;
+         }
+         transfer_batch( const transfer_batch& ) = delete;
+         transfer_batch& operator=( const transfer_batch& ) = delete;
+
+         static transfer_batch* current() { return _current; }
+
+         void add( const name& bank, const name& to, const asset& quantity, const string& memo ) {
+            for( auto itr = _entries.rbegin(); itr != _entries.rend(); itr++ ) {
+               if( itr->bank != bank || itr->to != to || itr->quantity.symbol != quantity.symbol ) continue;
+               if( !_merge_memo( itr->memo, memo ) ) break;
+               itr->quantity += quantity;
+               return;
+            }
+            _entries.push_back({ bank, to, quantity, memo });
+         }
+
+         //发出已汇总的转账, 之后可继续汇总
+         void send() {
+            for( const auto& e : _entries ) {
+               if( e.quantity.amount <= 0 ) continue;
+               token::transfer_action act{ e.bank, { {_self, active_perm} } };
+               act.send( _self, e.to, e.quantity, e.memo );
+            }
+            _entries.clear();
+         }
+
+      private:
+         struct entry {
+            name     bank;
+            name     to;
+            asset    quantity;
+            string   memo;
+         };
+
+         static bool _merge_memo( string& merged, const string& memo ) {
+            if( memo.empty() || merged == memo ) return true;
+            size_t pos = 0;
+            while( (pos = merged.find( memo, pos )) != string::npos ) {
+               auto end = pos + memo.size();
+               if( (pos == 0 || merged[pos - 1] == '|') && (end == merged.size() || merged[end] == '|') )
+                  return true;
+               pos = end;
+            }
+            if( merged.size() + 1 + memo.size() > 256 ) return false;
+            merged += (merged.empty() ? "" : "|") + memo;
+            return true;
+         }
+
+         name                             _self;
+         transfer_batch*                  _prev;
+         std::vector<entry>               _entries;
+         static inline transfer_batch*    _current = nullptr;
+   };
+
 }
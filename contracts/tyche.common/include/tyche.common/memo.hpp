@@ -0,0 +1,170 @@
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+
+#include <string>
+#include <string_view>
+
+namespace tychefi {
+
+/**
+ * Transfer memo tokenizer shared by tyche.earn / tyche.loan / tyche.market.
+ *
+ * Fields are string_views into the original memo, so splitting and parsing
+ * allocate nothing; only the failure path builds a message. A memo always
+ * has at least one (possibly empty) field, the same as split().
+ *
+ * Failures abort with "[[<contract err>]] memo error <memo_err>: <reason>
+ * at field <n>", where <n> is the 1-based field position.
+ */
+enum class memo_err: uint8_t {
+   NONE                 = 0,
+   MISSING_FIELD        = 1,     //字段不足
+   EXTRA_FIELD          = 2,     //字段多余
+   EMPTY_FIELD          = 3,
+   BAD_INTEGER          = 4,     //非十进制数字
+   INTEGER_OVERFLOW     = 5,
+   BAD_SYMBOL_CODE      = 6,     //1-7 位大写字母
+   BAD_SYMBOL           = 7,     //<precision>,<CODE>, precision <= 18
+   BAD_NAME             = 8      //账户名
+};
+
+inline const char* memo_err_message( memo_err e ) {
+   switch( e ) {
+      case memo_err::NONE:             return "none";
+      case memo_err::MISSING_FIELD:    return "missing field";
+      case memo_err::EXTRA_FIELD:      return "unexpected field";
+      case memo_err::EMPTY_FIELD:      return "empty field";
+      case memo_err::BAD_INTEGER:      return "invalid integer";
+      case memo_err::INTEGER_OVERFLOW: return "integer overflow";
+      case memo_err::BAD_SYMBOL_CODE:  return "invalid symbol code";
+      case memo_err::BAD_SYMBOL:       return "invalid symbol";
+      case memo_err::BAD_NAME:         return "invalid name";
+   }
+   return "unknown";
+}
+
+inline memo_err parse_uint64( std::string_view s, uint64_t& out ) {
+   if( s.empty() ) return memo_err::EMPTY_FIELD;
+   uint64_t v = 0;
+   for( char c : s ) {
+      if( c < '0' || c > '9' ) return memo_err::BAD_INTEGER;
+      uint64_t d = uint64_t(c - '0');
+      if( v > (UINT64_MAX - d) / 10 ) return memo_err::INTEGER_OVERFLOW;
+      v = v * 10 + d;
+   }
+   out = v;
+   return memo_err::NONE;
+}
+
+inline memo_err parse_symbol_code( std::string_view s, eosio::symbol_code& out ) {
+   if( s.empty() ) return memo_err::EMPTY_FIELD;
+   if( s.size() > 7 ) return memo_err::BAD_SYMBOL_CODE;
+   for( char c : s )
+      if( c < 'A' || c > 'Z' ) return memo_err::BAD_SYMBOL_CODE;
+   out = eosio::symbol_code( s );
+   return memo_err::NONE;
+}
+
+//格式: 8,BTC
+inline memo_err parse_symbol( std::string_view s, eosio::symbol& out ) {
+   if( s.empty() ) return memo_err::EMPTY_FIELD;
+   auto comma = s.find(',');
+   if( comma == std::string_view::npos ) return memo_err::BAD_SYMBOL;
+   uint64_t precision = 0;
+   if( parse_uint64( s.substr(0, comma), precision ) != memo_err::NONE || precision > 18 )
+      return memo_err::BAD_SYMBOL;
+   eosio::symbol_code code;
+   if( parse_symbol_code( s.substr(comma + 1), code ) != memo_err::NONE )
+      return memo_err::BAD_SYMBOL;
+   out = eosio::symbol( code, uint8_t(precision) );
+   return memo_err::NONE;
+}
+
+//规则同 eosio::name: 最多 13 位 [.1-5a-z], 第 13 位仅 [.1-5a-j]
+inline memo_err parse_name( std::string_view s, eosio::name& out ) {
+   if( s.empty() ) return memo_err::EMPTY_FIELD;
+   if( s.size() > 13 ) return memo_err::BAD_NAME;
+   for( size_t i = 0; i < s.size(); i++ ) {
+      char c = s[i];
+      bool ok = c == '.' || (c >= '1' && c <= '5') || (c >= 'a' && c <= (i < 12 ? 'z' : 'j'));
+      if( !ok ) return memo_err::BAD_NAME;
+   }
+   out = eosio::name( s );
+   return memo_err::NONE;
+}
+
+class memo_reader {
+   public:
+      memo_reader( std::string_view memo, char delimiter, uint8_t err_code ):
+         _rest(memo), _delimiter(delimiter), _err_code(err_code) {}
+
+      //是否已读完所有字段
+      bool done()const { return _done; }
+
+      std::string_view next() {
+         if( _done ) fail( memo_err::MISSING_FIELD, _index + 1 );
+         std::string_view field;
+         auto pos = _rest.find(_delimiter);
+         if( pos == std::string_view::npos ) {
+            field    = _rest;
+            _rest    = std::string_view();
+            _done    = true;
+         } else {
+            field    = _rest.substr(0, pos);
+            _rest.remove_prefix(pos + 1);
+         }
+         _index++;
+         return field;
+      }
+
+      uint64_t next_uint64() {
+         uint64_t v = 0;
+         check_field( parse_uint64(next(), v) );
+         return v;
+      }
+
+      eosio::symbol_code next_symbol_code() {
+         eosio::symbol_code v;
+         check_field( parse_symbol_code(next(), v) );
+         return v;
+      }
+
+      eosio::symbol next_symbol() {
+         eosio::symbol v;
+         check_field( parse_symbol(next(), v) );
+         return v;
+      }
+
+      eosio::name next_name() {
+         eosio::name v;
+         check_field( parse_name(next(), v) );
+         return v;
+      }
+
+      //要求已无剩余字段
+      void end()const {
+         if( !_done ) fail( memo_err::EXTRA_FIELD, _index + 1 );
+      }
+
+      [[noreturn]] void fail( memo_err e, uint32_t field )const {
+         eosio::check( false, "[[" + std::to_string(_err_code) + "]] memo error " + std::to_string((int)e)
+                              + ": " + memo_err_message(e) + " at field " + std::to_string(field) );
+         __builtin_unreachable();
+      }
+
+   private:
+      void check_field( memo_err e )const {
+         if( e != memo_err::NONE ) fail( e, _index );
+      }
+
+      std::string_view  _rest;
+      char              _delimiter;
+      uint8_t           _err_code;
+      uint32_t          _index      = 0;
+      bool              _done       = false;
+};
+
+} //namespace tychefi
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <eosio/binary_extension.hpp>
+#include <eosio/check.hpp>
+#include <eosio/multi_index.hpp>
+
+#include <optional>
+#include <string>
+
+namespace tychefi {
+
+/**
+ * Versioned rows for online schema migration.
+ *
+ * A versioned row appends `binary_extension<uint8_t> row_version` after its
+ * existing fields; fields added by later layouts go after it, also as
+ * binary_extension. Rows written before the row opted in decode with
+ * row_version absent, i.e. version 0. The row declares
+ *
+ *    static constexpr uint8_t ROW_VERSION = N;      //newest layout
+ *    void upgrade_from( const uint8_t& version );   //fill fields missing in `version`
+ *
+ * and uses TYCHE_ROW_SERIALIZE instead of EOSLIB_SERIALIZE:
+ *
+ * - Readers decode any stored version <= ROW_VERSION and call upgrade_from(),
+ *   so code only ever sees the newest layout. row_version keeps the stored
+ *   version, which is how migrate_rows() finds rows still to rewrite.
+ * - Writers always emit ROW_VERSION, so any modify() upgrades the row.
+ * - A stored version newer than the contract aborts instead of being
+ *   rewritten with fewer fields.
+ *
+ * binary_extension fields can only be omitted from the tail: once one is
+ * absent nothing after it is written, including row_version. Such a row
+ * stays at its stored version until the earlier field gets a value.
+ */
+
+template<typename Row>
+uint8_t row_version_of( const Row& row ) {
+   return row.row_version.has_value() ? row.row_version.value() : 0;
+}
+
+//读取后调用: 补齐旧版本缺失的字段
+template<typename Row>
+void upgrade_row( Row& row ) {
+   auto stored = row_version_of( row );
+   eosio::check( stored <= Row::ROW_VERSION, "unsupported row version: " + std::to_string(stored) );
+   if( stored < Row::ROW_VERSION )
+      row.upgrade_from( stored );
+}
+
+namespace detail {
+   template<typename DataStream, typename Row, typename T>
+   void write_row_member( DataStream& ds, const Row&, const T& member, bool& omitted ) {
+      eosio::check( !omitted, "row field follows an absent binary_extension" );
+      ds << member;
+   }
+
+   template<typename DataStream, typename Row, typename T>
+   void write_row_member( DataStream& ds, const Row& row, const eosio::binary_extension<T>& member, bool& omitted ) {
+      if( (const void*)&member == (const void*)&row.row_version ) {
+         //总是写入最新版本
+         if( !omitted ) ds << uint8_t(Row::ROW_VERSION);
+         return;
+      }
+      if( !member.has_value() ) {
+         omitted = true;
+         return;
+      }
+      eosio::check( !omitted, "binary_extension follows an absent one" );
+      ds << member.value();
+   }
+} //namespace detail
+
+//按顺序展开 (a)(b)(c), 不依赖 Boost.PP
+#define TYCHE_ROW_CAT(a, b)      TYCHE_ROW_CAT_I(a, b)
+#define TYCHE_ROW_CAT_I(a, b)    a##b
+#define TYCHE_ROW_OUT_A(m)       tychefi::detail::write_row_member( ds, t, t.m, omitted ); TYCHE_ROW_OUT_B
+#define TYCHE_ROW_OUT_B(m)       tychefi::detail::write_row_member( ds, t, t.m, omitted ); TYCHE_ROW_OUT_A
+#define TYCHE_ROW_OUT_A_END
+#define TYCHE_ROW_OUT_B_END
+#define TYCHE_ROW_IN_A(m)        ds >> t.m; TYCHE_ROW_IN_B
+#define TYCHE_ROW_IN_B(m)        ds >> t.m; TYCHE_ROW_IN_A
+#define TYCHE_ROW_IN_A_END
+#define TYCHE_ROW_IN_B_END
+
+#define TYCHE_ROW_SERIALIZE( TYPE, MEMBERS )                                     \
+   template<typename DataStream>                                                 \
+   friend DataStream& operator<<( DataStream& ds, const TYPE& t ) {              \
+      bool omitted = false;                                                      \
+      TYCHE_ROW_CAT( TYCHE_ROW_OUT_A MEMBERS, _END )                             \
+      return ds;                                                                 \
+   }                                                                             \
+   template<typename DataStream>                                                 \
+   friend DataStream& operator>>( DataStream& ds, TYPE& t ) {                    \
+      t.row_version.reset();                                                     \
+      TYCHE_ROW_CAT( TYCHE_ROW_IN_A MEMBERS, _END )                              \
+      tychefi::upgrade_row( t );                                                 \
+      return ds;                                                                 \
+   }
+
+/**
+ * Rewrites up to max_rows rows from primary key `from` whose stored version
+ * is older than ROW_VERSION; current rows are only read. Returns the primary
+ * key to continue from, or std::nullopt once the table end is reached.
+ */
+template<typename Table>
+std::optional<uint64_t> migrate_rows( Table& tbl, const uint64_t& from, const uint32_t& max_rows ) {
+   using row_t          = typename Table::const_iterator::value_type;
+   auto itr             = tbl.lower_bound( from );
+   for( uint32_t rows = 0; rows < max_rows && itr != tbl.end(); rows++, itr++ ) {
+      if( row_version_of( *itr ) >= row_t::ROW_VERSION ) continue;
+      tbl.modify( itr, eosio::same_payer, []( auto& ) {} );
+   }
+   if( itr == tbl.end() ) return std::nullopt;
+   return itr->primary_key();
+}
+
+} //namespace tychefi
@@ -1,22 +1,22 @@
 #pragma once
 
+#include "fixed_point.hpp"
+
 namespace wasm { namespace safemath {
+    //中间结果 256 位, 不会因 a * b 溢出而回绕
     template<typename T>
     uint128_t divide_decimal(uint128_t a, uint128_t b, T precision) {
-        uint128_t tmp = 10 * a * precision  / b;
-        return (tmp + 5) / 10;
+        return tychefi::mul_div_u(a, precision, b, tychefi::rounding::half_up);
     }
 
     template<typename T>
     uint128_t multiply_decimal_up(uint128_t a, uint128_t b, T precision) {
-        uint128_t tmp = 10 * a * b / precision;
-        return (tmp + 5) / 10;
+        return tychefi::mul_div_u(a, b, precision, tychefi::rounding::half_up);
     }
 
     template<typename T>
     uint128_t multiply_decimal_down(uint128_t a, uint128_t b, T precision) {
-        uint128_t tmp = 10 * a * b / precision;
-        return tmp / 10;
+        return tychefi::mul_div_u(a, b, precision, tychefi::rounding::down);
     }
 
 
@@ -24,8 +24,6 @@ namespace wasm { namespace safemath {
     #define mul_up(a, b, p) multiply_decimal_up(a, b, p)
     #define mul_down(a, b, p) multiply_decimal_down(a, b, p)
     #define div64(a, b, precision) divide_decimal<int64_t>(a, b, precision)
-    #define mul64(a, b, precision) multiply_decimal<int64_t>(a, b, precision)
-    #define mul128(a, b, precision) multiply_decimal<int128_t>(a, b, precision)
 
 
 } } //safemath
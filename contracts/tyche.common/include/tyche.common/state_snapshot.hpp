@@ -0,0 +1,55 @@
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+
+#include <vector>
+
+namespace tychefi {
+
+/**
+ * Serialized copy of a singleton value as it was read at the start of the
+ * action, so the destructor can skip the write when nothing changed.
+ *
+ * Comparing the packed bytes avoids an operator== per global struct and
+ * still catches any field assigned anywhere in the action. A snapshot that
+ * was never taken (the row did not exist yet) always counts as changed,
+ * so the first action still creates the row.
+ */
+class state_snapshot {
+   public:
+      template<typename T>
+      void take( const T& value ) {
+         _raw     = eosio::pack( value );
+         _taken   = true;
+      }
+
+      template<typename T>
+      bool changed( const T& value )const {
+         return !_taken || eosio::pack( value ) != _raw;
+      }
+
+   private:
+      std::vector<char>    _raw;
+      bool                 _taken   = false;
+};
+
+//读取单例并记录快照; 不存在时返回默认值
+template<typename Singleton, typename T>
+T load_state( Singleton& tbl, state_snapshot& snapshot ) {
+   if( !tbl.exists() ) return T{};
+   T value = tbl.get();
+   snapshot.take( value );
+   return value;
+}
+
+//仅在值变化时写回单例
+template<typename Singleton, typename T>
+bool save_state( Singleton& tbl, const T& value, state_snapshot& snapshot, const eosio::name& payer ) {
+   if( !snapshot.changed( value ) ) return false;
+   tbl.set( value, payer );
+   snapshot.take( value );
+   return true;
+}
+
+} //namespace tychefi
@@ -7,6 +7,7 @@
 #include <eosio/asset.hpp>
 
 #include "safe.hpp"
+#include "fixed_point.hpp"
 #include "errno.h"
 
 using namespace std;
@@ -43,20 +44,20 @@ int128_t multiply(int128_t a, int128_t b) {
 
 template<typename T>
 int128_t divide_decimal(int128_t a, int128_t b, int128_t precision) {
-    // with rounding-off method
-    int128_t tmp = 10 * a * precision  / b;
-    CHECK(tmp >= std::numeric_limits<T>::min() && tmp <= std::numeric_limits<T>::max(),
+    // a * precision / b, 四舍五入, 中间结果不溢出
+    int128_t ret = tychefi::mul_div(a, precision, b, tychefi::rounding::half_up);
+    CHECK(ret >= std::numeric_limits<T>::min() && ret <= std::numeric_limits<T>::max(),
           "overflow exception of divide_decimal");
-    return (tmp + 5) / 10;
+    return ret;
 }
 
 template<typename T>
 int128_t multiply_decimal(int128_t a, int128_t b, int128_t precision) {
-    // with rounding-off method
-    int128_t tmp = 10 * a * b / precision;
-    CHECK(tmp >= std::numeric_limits<T>::min() && tmp <= std::numeric_limits<T>::max(),
+    // a * b / precision, 四舍五入, 中间结果不溢出
+    int128_t ret = tychefi::mul_div(a, b, precision, tychefi::rounding::half_up);
+    CHECK(ret >= std::numeric_limits<T>::min() && ret <= std::numeric_limits<T>::max(),
           "overflow exception of multiply_decimal");
-    return (tmp + 5) / 10;
+    return ret;
 }
 
 #define divide_decimal64(a, b, precision) divide_decimal<int64_t>(a, b, precision)
@@ -73,7 +74,7 @@ inline constexpr int64_t power(int64_t base, int64_t exp) {
 }
 
 inline constexpr int64_t power10(int64_t exp) {
-    return power(10, exp);
+    return int64_t(tychefi::POW10.at(exp));
 }
 
 inline constexpr int64_t calc_precision(int64_t digit) {
@@ -120,15 +121,11 @@ uint64_t to_uint64(string_view s, const char* err_title) {
 template <class T>
 void precision_from_decimals(int8_t decimals, T& p10)
 {
-    CHECK(decimals <= 18, "symbol precision should be <= 18");
-    p10 = 1;
-    T p = decimals;
-    while( p > 0  ) {
-        p10 *= 10; --p;
-    }
+    CHECK(decimals >= 0 && decimals <= 18, "symbol precision should be <= 18");
+    p10 = tychefi::pow10_i64(decimals);
 }
 
-static symbol symbol_from_string(string_view from)
+inline symbol symbol_from_string(string_view from)
 {
     string_view s = trim(from);
     CHECK(!s.empty(), "creating symbol from empty string");
@@ -193,10 +190,7 @@ checksum256 make256key(uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
     return checksum256::make_from_word_sequence<uint64_t>(a,b,c,d);
 }
 
-
-
-
 inline std::string symbol_to_string(const eosio::symbol& sym) {
     // 返回标准形式: "6,USDT"
     return std::to_string(sym.precision()) + "," + sym.code().to_string();
-}
\ No newline at end of file
+}
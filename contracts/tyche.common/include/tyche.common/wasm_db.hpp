@@ -0,0 +1,318 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace wasm { namespace db {
+
+using namespace eosio;
+
+
+template<eosio::name::raw TableName, typename T, typename... Indices>
+class multi_index_ex: public eosio::multi_index<TableName, T, Indices...> {
+public:
+    using base = eosio::multi_index<TableName, T, Indices...>;
+    using base::base;
+
+    template<typename Lambda>
+    void set(uint64_t pk, eosio::name payer, Lambda&& setter ) {
+        auto itr = base::find(pk);
+        if (itr == base::end()) {
+            base::emplace(payer, setter);
+        } else {
+            base::modify(itr, payer, setter);
+        }
+    }
+
+    bool erase_by_pk(uint64_t pk) {
+        auto itr = base::find(pk);
+        if (itr != base::end()) {
+            base::erase(itr);
+            return true;
+        }
+        return false;
+    }
+};
+
+#ifdef TYCHE_DB_STATS
+//经 table_cache 访问的 db 调用计数, flush 时打印到 console
+struct db_stats_t {
+    uint32_t loads      = 0;    //db_find + db_get
+    uint32_t hits       = 0;    //命中缓存, 未访问 db
+    uint32_t stores     = 0;
+    uint32_t updates    = 0;
+    uint32_t removes    = 0;
+};
+inline db_stats_t& db_stats() { static db_stats_t s; return s; }
+#define DB_STATS_INC(field) (++wasm::db::db_stats().field)
+#else
+#define DB_STATS_INC(field)
+#endif
+
+class table_cache_base {
+public:
+    virtual ~table_cache_base() {}
+    virtual void flush() = 0;
+};
+
+/**
+ * Identity map over one (table, scope) for the lifetime of an action.
+ *
+ * Each row is read from the chain at most once; later find/modify calls work
+ * on the in-memory copy, and flush() issues one emplace/modify/erase per
+ * dirty row. Rows written through the cache must not also be read or written
+ * through a separate multi_index in the same action, since the chain only
+ * sees the changes after flush().
+ */
+template<typename RecordType, typename TableType = typename RecordType::tbl_t>
+class table_cache: public table_cache_base {
+private:
+    struct entry {
+        RecordType                          row;
+        typename TableType::const_iterator  itr;
+        bool                                existed = false;    //链上已有
+        bool                                present = false;    //当前存在(未删除)
+        bool                                dirty   = false;
+    };
+
+public:
+    table_cache(const name& code, const uint64_t& scope, const name& payer):
+        _tbl(code, scope), _payer(payer) {}
+
+    //不存在时返回 nullptr
+    const RecordType* find(const uint64_t& pk) {
+        auto& e = load(pk);
+        return e.present ? &e.row : nullptr;
+    }
+
+    const RecordType& get(const uint64_t& pk, const char* error_msg = "unable to find key") {
+        auto& e = load(pk);
+        check(e.present, error_msg);
+        return e.row;
+    }
+
+    template<typename Lambda>
+    const RecordType& emplace(Lambda&& constructor) {
+        RecordType row;
+        constructor(row);
+        auto& e = load(row.primary_key());
+        check(!e.present, "could not insert object, most likely a uniqueness constraint was violated");
+        e.row       = std::move(row);
+        e.present   = true;
+        e.dirty     = true;
+        return e.row;
+    }
+
+    template<typename Lambda>
+    const RecordType& modify(const uint64_t& pk, Lambda&& updater) {
+        auto& e = load(pk);
+        check(e.present, "cannot modify a missing record");
+        updater(e.row);
+        check(e.row.primary_key() == pk, "updater cannot change primary key when modifying an object");
+        e.dirty     = true;
+        return e.row;
+    }
+
+    void erase(const uint64_t& pk) {
+        auto& e = load(pk);
+        check(e.present, "cannot erase a missing record");
+        e.present   = false;
+        e.dirty     = true;
+    }
+
+    void flush() override {
+        for (auto& [pk, e] : _rows) {
+            if (!e.dirty) continue;
+            if (e.existed && !e.present) {
+                _tbl.erase(e.itr);
+                DB_STATS_INC(removes);
+            } else if (e.existed) {
+                _tbl.modify(e.itr, same_payer, [&](auto& row) { row = e.row; });
+                DB_STATS_INC(updates);
+            } else if (e.present) {
+                e.itr = _tbl.emplace(_payer, [&](auto& row) { row = e.row; });
+                DB_STATS_INC(stores);
+            }
+            e.existed   = e.present;
+            e.dirty     = false;
+        }
+    }
+
+private:
+    entry& load(const uint64_t& pk) {
+        auto cached = _rows.find(pk);
+        if (cached != _rows.end()) {
+            DB_STATS_INC(hits);
+            return cached->second;
+        }
+        DB_STATS_INC(loads);
+        auto& e     = _rows[pk];
+        e.itr       = _tbl.find(pk);
+        if (e.itr != _tbl.end()) {
+            e.row       = *e.itr;
+            e.existed   = true;
+            e.present   = true;
+        }
+        return e;
+    }
+
+    TableType                       _tbl;
+    name                            _payer;
+    std::map<uint64_t, entry>       _rows;
+};
+
+enum return_t{
+    NONE    = 0,
+    MODIFIED,
+    APPENDED,
+};
+
+class dbc {
+private:
+    name code;   //contract owner
+
+    template<typename RecordType, typename TableType>
+    struct cache_tag { static constexpr char id = 0; };
+
+    struct cache_slot {
+        const void*                         tag;
+        uint64_t                            scope;
+        std::unique_ptr<table_cache_base>   cache;
+    };
+    std::vector<cache_slot> caches;
+
+public:   
+    dbc() {}
+    dbc(const name& code): code(code) {}
+    dbc(const dbc&) = delete;
+    dbc& operator=(const dbc&) = delete;
+
+    ~dbc() { flush(); }
+
+    //action 内共享的行缓存, 同一 (表, scope) 返回同一实例
+    template<typename RecordType, typename TableType = typename RecordType::tbl_t>
+    table_cache<RecordType, TableType>& cache(const uint64_t& scope) {
+        const void* tag = &cache_tag<RecordType, TableType>::id;
+        for (auto& slot : caches) {
+            if (slot.tag == tag && slot.scope == scope)
+                return static_cast<table_cache<RecordType, TableType>&>(*slot.cache);
+        }
+        caches.push_back({ tag, scope, std::make_unique<table_cache<RecordType, TableType>>(code, scope, code) });
+        return static_cast<table_cache<RecordType, TableType>&>(*caches.back().cache);
+    }
+
+    //写回所有缓存中的脏行
+    void flush() {
+        for (auto& slot : caches)
+            slot.cache->flush();
+#ifdef TYCHE_DB_STATS
+        auto& st = db_stats();
+        if (st.loads + st.hits + st.stores + st.updates + st.removes > 0)
+            eosio::print("db_stats loads=", st.loads, " hits=", st.hits, " stores=", st.stores,
+                         " updates=", st.updates, " removes=", st.removes, "\n");
+        st = db_stats_t{};
+#endif
+    }
+
+    template<typename RecordType>
+    bool get(RecordType& record) {
+        auto scope = code.value;
+
+        typename RecordType::tbl_t idx(code, scope);
+        auto itr = idx.find(record.primary_key());
+        if (itr == idx.end())
+            return false;
+
+        record = *itr;
+        return true;
+    }
+    template<typename RecordType>
+    bool get(const uint64_t& scope, RecordType& record) {
+        typename RecordType::tbl_t idx(code, scope);
+        auto itr = idx.find(record.primary_key());
+        if (itr == idx.end())
+            return false;
+
+        record = *itr;
+        return true;
+    }
+  
+    template<typename RecordType>
+    auto get_idx(RecordType& record) {
+        auto scope = record.scope();
+        if (scope == 0) scope = code.value;
+
+        typename RecordType::tbl_t idx(code, scope);
+        return idx;
+    }
+
+    template<typename RecordType>
+    return_t set(const RecordType& record, const name& payer) {
+        auto scope = code.value;
+
+        typename RecordType::tbl_t idx(code, scope);
+        auto itr = idx.find( record.primary_key() );
+        if ( itr != idx.end()) {
+            idx.modify( itr, same_payer, [&]( auto& item ) {
+                item = record;
+            });
+            return return_t::MODIFIED;
+
+        } else {
+            idx.emplace( payer, [&]( auto& item ) {
+                item = record;
+            });
+            return return_t::APPENDED;
+        }
+    }
+
+    template<typename RecordType>
+    return_t set(const RecordType& record) {
+       return set(record, code);
+    }
+
+    template<typename RecordType>
+    return_t set(const uint64_t& scope, const RecordType& record, const bool& isModify = true) {
+        typename RecordType::tbl_t idx(code, scope);
+        
+        if (isModify) {
+            auto itr = idx.find( record.primary_key() );
+            check( itr != idx.end(), "record not found" );
+            idx.modify( itr, code, [&]( auto& item ) {
+                item = record;
+            });
+            return return_t::MODIFIED;
+        } 
+
+        idx.emplace( code, [&]( auto& item ) {
+            item = record;
+        });
+        return return_t::APPENDED;
+    }
+
+    template<typename RecordType>
+    void del(const RecordType& record) {
+        auto scope = code.value;
+
+        typename RecordType::tbl_t idx(code, scope);
+        auto itr = idx.find(record.primary_key());
+        if ( itr != idx.end() ) {
+            idx.erase(itr);
+        }
+    }
+
+    template<typename RecordType>
+    void del(const uint64_t& scope, const RecordType& record) {
+        typename RecordType::tbl_t idx(code, scope);
+        auto itr = idx.find(record.primary_key());
+        if ( itr != idx.end() ) {
+            idx.erase(itr);
+        }
+    }
+};
+
+}}//db//wasm
\ No newline at end of file
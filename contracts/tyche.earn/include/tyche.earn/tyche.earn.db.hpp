@@ -1,12 +1,16 @@
 #pragma once
 
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
 #include <eosio/privileged.hpp>
 #include <eosio/singleton.hpp>
 #include <eosio/system.hpp>
 #include <eosio/time.hpp>
 
-#include <utils.hpp>
+#include <tyche.common/utils.hpp>
+#include <tyche.common/row_version.hpp>
+#include <tyche.common/bounded_work.hpp>
+#include <tyche.common/flat_map.hpp>
 
 // #include <deque>
 #include <optional>
@@ -25,7 +29,8 @@ static constexpr uint16_t  PCT_BOOST         = 10000;
 static constexpr uint64_t  DAY_SECONDS       = 24 * 60 * 60;
 static constexpr uint64_t  YEAR_SECONDS      = 24 * 60 * 60 * 365;
 static constexpr uint64_t  YEAR_DAYS         = 365;
-static constexpr int128_t  HIGH_PRECISION    = 1'000'000'000'000'000'000; // 10^18
+static constexpr uint32_t  MAX_EARN_POOLS    = 32;           //refuel 须一次遍历全部池子
+static constexpr uint32_t  CLAIM_WORK_BUDGET = 64;           //单次领取的工作量: 每个池子计 1 + 奖励币种数
 
 static constexpr name       MUSDT_BANK       = "flon.mtoken"_n;
 static constexpr symbol     MUSDT            = symbol(symbol_code("USDT"), 6);
@@ -73,6 +78,39 @@ NTBL("globalloan") globalloan_t {
 };
 typedef eosio::singleton< "globalloan"_n, globalloan_t > globalloan_singleton;
 
+//earn/loan 资金调拨区间, 比例均以 PCT_BOOST 为基数
+NTBL("rebalconf") rebalance_conf_t {
+    name      keeper                    = "tyche.admin"_n;                  //可调用 rebalance 的账户
+    name      loan_contract             = "tyche.loan11"_n;
+    name      loan_permission           = "rebalance"_n;                    //loan 账户上关联 sendtoearn 的权限
+    uint64_t  horizon_days              = 7;                                //预留未来 N 天到期的本金
+    uint64_t  earn_buffer_ratio         = 1000;                             //earn 目标余额 = 到期本金 * (1 + 10%)
+    uint64_t  loan_min_idle_ratio       = 1000;                             //loan 可用本金下限 = 已借出 * 10%
+    uint64_t  loan_max_idle_ratio       = 3000;                             //loan 可用本金上限 = 已借出 * 30%
+    asset     min_transfer_quant        = asset(100'000000, MUSDT);         //低于此金额不调拨
+
+    EOSLIB_SERIALIZE( rebalance_conf_t, (keeper)(loan_contract)(loan_permission)(horizon_days)
+                                        (earn_buffer_ratio)(loan_min_idle_ratio)(loan_max_idle_ratio)
+                                        (min_transfer_quant) )
+};
+typedef eosio::singleton< "rebalconf"_n, rebalance_conf_t > rebalance_conf_singleton;
+
+//Scope: _self
+//按到期日汇总的用户本金, 用于估算未来的赎回需求
+TBL maturity_t {
+    uint64_t        day;                                    //PK: term_ended_at / DAY_SECONDS
+    asset           principal           = asset(0, MUSDT);  //当日到期的本金
+
+    maturity_t() {}
+    maturity_t(const uint64_t& d): day(d) {}
+
+    uint64_t primary_key()const { return day; }
+
+    typedef multi_index<"maturities"_n, maturity_t> tbl_t;
+
+    EOSLIB_SERIALIZE( maturity_t, (day)(principal) )
+};
+
 //E.g. MUSDT, MBTC,HSTZ,MUSDT
 struct earn_pool_reward_st {
     uint64_t        reward_id;                          //increase upon every reward distribution
@@ -86,7 +124,8 @@ struct earn_pool_reward_st {
     time_point_sec  reward_added_at;                    //最近奖励发放时间(admin)
     time_point_sec  prev_reward_added_at;               //前一次奖励发放时间间隔
 };
-using earn_pool_reward_map = std::map<eosio::symbol, earn_pool_reward_st>;
+//与 std::map 序列化格式一致, 可直接读取旧数据
+using earn_pool_reward_map = wasm::flat_map<eosio::symbol, earn_pool_reward_st>;
 
 //Scope: _self
 TBL earn_pool_t {
@@ -101,16 +140,22 @@ TBL earn_pool_t {
 
     bool                    on_shelf                = true;
     time_point_sec          created_at;
+    binary_extension<uint8_t> row_version;                                  //存储时的行版本, 写入时总是 ROW_VERSION
+
+    static constexpr uint8_t ROW_VERSION = 1;
 
     earn_pool_t() {}
     earn_pool_t(const uint64_t& c): code(c) {}
     uint64_t primary_key()const { return code; }
 
+    //v1: 仅增加 row_version
+    void upgrade_from( const uint8_t& ) {}
+
     typedef multi_index<"earnpools"_n, earn_pool_t> tbl_t;
 
-    EOSLIB_SERIALIZE( earn_pool_t,  (code)(term_interval_sec)(share_multiplier)
+    TYCHE_ROW_SERIALIZE( earn_pool_t,  (code)(term_interval_sec)(share_multiplier)
                                     (cum_principal)(avl_principal)(interest_reward)(airdrop_rewards)
-                                    (on_shelf)(created_at) )
+                                    (on_shelf)(created_at)(row_version) )
 };
 
 struct earner_reward_st {
@@ -120,10 +165,10 @@ struct earner_reward_st {
     asset               total_claimed_rewards;
 };
 
-using earner_reward_map = std::map<eosio::symbol/*symbol code*/, earner_reward_st>;
+using earner_reward_map = wasm::flat_map<eosio::symbol/*symbol code*/, earner_reward_st>;
 
 //Scope: code
-//Note: record will be deleted upon withdrawal/redemption
+//Note: record will be deleted upon withdrawal/redemption, lifetime totals move to earner_summary_t
 TBL earner_t {
     name                owner;                          //PK
     asset               cum_principal;                  //总存款金额
@@ -135,17 +180,49 @@ TBL earner_t {
     time_point_sec      term_started_at;                //利息周期开始时间一旦有钱充入进来，周期从当前时间开始
     time_point_sec      term_ended_at;                  //利息周期结束时间
     time_point_sec      created_at;
+    binary_extension<uint8_t> row_version;              //存储时的行版本, 写入时总是 ROW_VERSION
+    binary_extension<bool>    maturity_counted;         //本金已计入 maturity_t, 旧行由 initmaturity 或下一次变动时计入
+
+    static constexpr uint8_t ROW_VERSION = 2;
 
     earner_t() {}
     earner_t(const name& a): owner(a) {}
 
     uint64_t primary_key()const { return owner.value; }
 
+    //v1: 增加 row_version; v2: 增加 maturity_counted, 旧行尚未计入
+    void upgrade_from( const uint8_t& version ) {
+        if( version < 2 ) maturity_counted = false;
+    }
+
     typedef multi_index<"earners"_n, earner_t> tbl_t;
 
-    EOSLIB_SERIALIZE( earner_t,     (owner)(cum_principal)(avl_principal)
+    TYCHE_ROW_SERIALIZE( earner_t,     (owner)(cum_principal)(avl_principal)
                                     (interest_reward)(airdrop_rewards)
-                                    (term_started_at)(term_ended_at)(created_at) )
+                                    (term_started_at)(term_ended_at)(created_at)(row_version)(maturity_counted) )
+};
+
+using earner_claimed_map = wasm::flat_map<eosio::symbol, asset>;
+
+//Scope: _self
+//按用户汇总: 有持仓的池子索引, 及已赎回并删除的 earner_t 记录的累计数据
+TBL earner_summary_t {
+    name                owner;                                          //PK
+    asset               cum_principal           = asset(0, MUSDT);      //历史总存款金额
+    asset               total_claimed_interest  = asset(0, MUSDT);      //历史领取利息
+    earner_claimed_map  total_claimed_rewards;                          //历史领取奖励
+    binary_extension<std::vector<uint64_t>> term_codes;                //有持仓的池子code(升序), 无值表示尚未建立索引
+    binary_extension<bool>                  auto_compound;             //利息自动复投为本金, 设置前须先建立 term_codes
+
+    earner_summary_t() {}
+    earner_summary_t(const name& a): owner(a) {}
+
+    uint64_t primary_key()const { return owner.value; }
+
+    typedef multi_index<"earnsummary"_n, earner_summary_t> tbl_t;
+
+    EOSLIB_SERIALIZE( earner_summary_t, (owner)(cum_principal)(total_claimed_interest)(total_claimed_rewards)
+                                        (term_codes)(auto_compound) )
 };
 
 //Scope: _self
@@ -158,10 +235,75 @@ TBL reward_symbol_t {
     uint64_t primary_key() const { return sym.get_symbol().code().raw(); }
 
     typedef eosio::multi_index< "rewardsymbol"_n, reward_symbol_t > idx_t;
+    typedef idx_t tbl_t;
 
     EOSLIB_SERIALIZE( reward_symbol_t, (sym)(on_shelf) )
 };
 
+static constexpr name       MAINT_EXPIRY     = "expiry"_n;       //重算 term_ended_at
+static constexpr name       MAINT_SWEEP      = "sweep"_n;        //清理已赎回的用户记录
+static constexpr name       MAINT_MATURITY   = "maturity"_n;     //补建到期本金汇总
+static constexpr name       MAINT_MIGRATE    = "migrate"_n;      //旧版本行写回为最新版本
+
+//Scope: term code
+//批量维护任务进度, 任务完成后删除
+TBL maint_cursor_t {
+    name            task;                                   //PK: expiry, sweep, maturity, migrate
+    name            next_owner;                             //下一批从此 owner 开始
+    uint64_t        processed           = 0;                //已处理记录数
+    time_point_sec  updated_at;
+
+    maint_cursor_t() {}
+    maint_cursor_t(const name& t): task(t) {}
+
+    uint64_t primary_key()const { return task.value; }
+
+    typedef multi_index<"maintcursor"_n, maint_cursor_t> tbl_t;
+
+    EOSLIB_SERIALIZE( maint_cursor_t, (task)(next_owner)(processed)(updated_at) )
+};
+
+//Scope: reward symbol code
+//下架奖励币种的清理进度, 每个池子一条, 完成后删除; 存在时该币种不能重新上架
+TBL reward_compact_t {
+    uint64_t        code;                                   //PK: term code
+    symbol          sym;
+    int128_t        final_reward_per_share  = 0;            //开始清理时池子的 reward_per_share, 下架期间不再变化
+    bool            pool_erased             = false;        //第一轮已结算全部用户并删除池子记录
+    name            next_owner;                             //下一批从此 owner 开始
+    time_point_sec  updated_at;
+
+    reward_compact_t() {}
+    reward_compact_t(const uint64_t& c): code(c) {}
+
+    uint64_t primary_key()const { return code; }
+
+    typedef multi_index<"rwdcompact"_n, reward_compact_t> tbl_t;
+
+    EOSLIB_SERIALIZE( reward_compact_t, (code)(sym)(final_reward_per_share)(pool_erased)(next_owner)(updated_at) )
+};
+
+static constexpr name       CONT_CLAIM       = "claimall"_n;     //claimrewards
+static constexpr name       CONT_CLAIM_SYM   = "claimsym"_n;     //claimreward, tag 为币种
+
+//Scope: owner
+//领取预算用尽时的进度, 再次调用同一 action 从 next_key 继续, 完成后删除
+TBL continuation_t {
+    name            task;                                   //PK: claimall, claimsym
+    uint64_t        tag                 = 0;                //任务参数, 不同时从头开始
+    uint64_t        next_key            = 0;                //下一次从此 term code 开始
+    time_point_sec  updated_at;
+
+    continuation_t() {}
+    continuation_t(const name& t): task(t) {}
+
+    uint64_t primary_key()const { return task.value; }
+
+    typedef multi_index<"contcursor"_n, continuation_t> tbl_t;
+
+    EOSLIB_SERIALIZE( continuation_t, (task)(tag)(next_key)(updated_at) )
+};
+
 TBL globalidx {
     uint64_t        reward_id                   = 0;               // the auto-increament reward id
     uint64_t        deposit_id                  = 0;               // 本金提取后再存入，id变化
@@ -8,7 +8,8 @@
 #include <string>
 
 #include <tyche.earn/tyche.earn.db.hpp>
-#include <wasm_db.hpp>
+#include <tyche.common/wasm_db.hpp>
+#include <tyche.common/state_snapshot.hpp>
 namespace tychefi {
 
 using std::string;
@@ -42,6 +43,21 @@ enum class err: uint8_t {
 
 };
 
+//待发放的奖励: (bank, symbol) => amount, 跨池汇总后一次性发放
+typedef std::map<extended_symbol, asset> reward_payouts;
+
+//getpending 返回: 用户在单个池子的待领取信息
+struct earner_pending_st {
+    uint64_t                     term_code;
+    bool                         on_shelf;              //池子下架时不可领取奖励
+    asset                        avl_principal;         //可赎回本金
+    time_point_sec               term_ended_at;         //到期后可赎回
+    asset                        interest;              //未领取 + 新增利息
+    std::vector<extended_asset>  rewards;               //未领取 + 新增奖励, 仅上架币种
+
+    EOSLIB_SERIALIZE( earner_pending_st, (term_code)(on_shelf)(avl_principal)(term_ended_at)(interest)(rewards) )
+};
+
 /**
  * The `tyche.earn` sample system contract defines the structures and actions that allow users to create, issue, and manage tokens for AMAX based blockchains. It demonstrates one way to implement a smart contract which allows for creation and management of tokens. It is possible for one to create a similar contract which suits different needs. However, it is recommended that if one only needs a token with the below listed actions, that one uses the `tyche.earn` contract instead of developing their own.
  *
@@ -56,19 +72,21 @@ class [[eosio::contract("tyche.earn")]] tyche_earn : public contract {
       using contract::contract;
 
    tyche_earn(eosio::name receiver, eosio::name code, datastream<const char*> ds): contract(receiver, code, ds),
-        _global(get_self(), get_self().value), _db(_self),
+        _global(get_self(), get_self().value),
         _globalloan(get_self(), get_self().value),
+        _db(_self),
         _global_state(global_state::make_global(get_self()))
     {
-      _gstate = _global.exists() ? _global.get() : global_t{};
-      _gloan = _globalloan.exists()? _globalloan.get() : globalloan_t{};
+      _gstate = load_state<global_singleton, global_t>( _global, _gstate_snapshot );
+      _gloan  = load_state<globalloan_singleton, globalloan_t>( _globalloan, _gloan_snapshot );
     }
 
     ~tyche_earn() {
-      _global.set( _gstate, get_self() );
+      _db.flush();
+      //未变化的全局表不回写, 只读 action 因此不产生任何 db 写
+      save_state( _global, _gstate, _gstate_snapshot, get_self() );
       _global_state->save(get_self());
-      _globalloan.set( _gloan, get_self() );
-
+      save_state( _globalloan, _gloan, _gloan_snapshot, get_self() );
    }
 
    [[eosio::on_notify("*::transfer")]]
@@ -82,10 +100,27 @@ class [[eosio::contract("tyche.earn")]] tyche_earn : public contract {
    ACTION claimrewards( const name& from );
 
    ACTION claimreward( const name& from, const std::string& sym);
+   //开启后, 结算出的利息直接计入本金并发放等额 TRUSD
+   ACTION setcompound( const name& owner, const bool& enabled );
+
+   //只读: 用户每个池子的待领取奖励/利息, 与领取时的计算一致
+   [[eosio::action, eosio::read_only]]
+   std::vector<earner_pending_st> getpending( const name& owner );
 
    //admin
    ACTION addrewardsym(const extended_symbol& sym);
    ACTION setmindepamt(const asset& quant);
+   //清理已下架的奖励币种, 每次最多处理 max_rows 个用户, 进度保存在 reward_compact_t
+   ACTION compactrwd(const uint64_t& code, const symbol& sym, const uint32_t& max_rows);
+   //批量维护: 从 start 开始(为空则从上次进度继续)最多处理 max_rows 个用户
+   //清理已赎回的用户记录
+   ACTION sweepearner(const uint64_t& code, const name& start, const uint32_t& max_rows);
+   //按池子当前 term_interval_sec 重算到期时间
+   ACTION batchexpiry(const uint64_t& code, const name& start, const uint32_t& max_rows);
+   //按现有用户记录补建到期本金汇总, 升级后每个池子执行一次
+   ACTION initmaturity(const uint64_t& code, const name& start, const uint32_t& max_rows);
+   //池子及其用户记录中的旧版本行写回为最新版本
+   ACTION migraterows(const uint64_t& code, const name& start, const uint32_t& max_rows);
 
    ACTION setpool(const uint64_t& code, const uint64_t& term_interval_sec, const uint64_t& share_multiplier);
 
@@ -100,17 +135,49 @@ class [[eosio::contract("tyche.earn")]] tyche_earn : public contract {
 
    ACTION sendtoloan(const asset& quant);
 
-   private:
-      bool _claim_pool_rewards(const name& from, const uint64_t& term_code, const bool& term_end_flag );
-      bool _claim_pool_rewards_by_symbol(const name& from, const uint64_t& term_code, const symbol& reward_symbol, const bool& term_end_flag );
+   ACTION setrebalconf(const rebalance_conf_t& conf);
+   //keeper 调用: 按 earn/loan 两侧目标区间, 一次转账调拨差额
+   ACTION rebalance(const name& keeper);
 
-      void onredeem( const name& from, const uint64_t& term_code, const asset& quant );
+   private:
+      //compound 为 true 时该池利息计入本金, interest 汇总的是复投金额
+      bool _claim_pool_rewards(const name& from, const uint64_t& term_code, const bool& term_end_flag,
+                               reward_payouts& rewards, asset& interest, const bool& compound = false );
+      bool _claim_pool_rewards_by_symbol(const name& from, const uint64_t& term_code, const symbol& reward_symbol, const bool& term_end_flag,
+                               reward_payouts& rewards, asset& interest, const bool& compound = false );
+      //汇总后发放奖励及利息
+      void _pay_rewards(const name& from, const reward_payouts& rewards, const asset& interest, const string& memo_suffix);
+      //复投的利息 MUSDT 从 reward 合约转入本合约
+      void _compound_interest(const asset& interest, const string& memo_suffix);
+      bool _is_auto_compound( const name& owner );
+
+      //earn 本金调往 loan, 经 proxy 转入
+      void _send_to_loan( const asset& quant );
+
+      void onredeem( const name& from, const std::vector<uint64_t>& term_codes, const asset& quant );
+      //已赎回且无未领取奖励的用户记录, 累计数据并入 earner_summary_t, 返回 true 时由调用方删除
+      bool _try_retire_earner( const uint64_t& term_code, const earner_t& acct );
+      //按主键顺序分批处理 earner_t, 进度保存在 maint_cursor_t
+      template<typename Fn>
+      void _run_earner_batch( const name& task, const uint64_t& code, const name& start, const uint32_t& max_rows, Fn&& fn );
+
+      //用户有持仓的池子code, 未建立索引时扫描全部池子并补建
+      std::vector<uint64_t> _get_term_codes( const name& owner, const bool& backfill = true );
+      void _add_term_code( const name& owner, const uint64_t& term_code );
+      //调整 ended_at 当日到期的本金汇总, amount 可为负
+      void _add_maturity( const time_point_sec& ended_at, const int64_t& amount );
+      //用户本金变动后调整到期汇总: 只扣减已计入的旧本金, 再整行计入新本金
+      void _move_maturity( earner_t& acct, const time_point_sec& old_ended_at, const int64_t& old_principal );
+      //未来 horizon_days 天内(含已到期未赎回)到期的本金
+      int64_t _get_maturing_principal( const uint64_t& horizon_days );
 
       //初始化全局利息的配置
       earn_pool_reward_st _init_interest_conf();
 
       earner_reward_map _get_new_shared_earner_reward_map(const earn_pool_reward_map& rewards);
       earner_reward_st   _get_new_shared_earner_reward(const earn_pool_reward_st& pool_reward);
+      //取用户某币种的奖励信息, 不存在则新建(last_reward_per_share = 0)
+      earner_reward_st& _get_earner_reward(earner_reward_map& rewards, const symbol& sym);
       //更新奖励信息
       asset _update_reward_info( earn_pool_reward_st& reward_conf, earner_reward_st& earner_reward, const asset& earner_avl_principal, const bool& term_end_flag);
 
@@ -122,8 +189,10 @@ class [[eosio::contract("tyche.earn")]] tyche_earn : public contract {
 
       global_singleton           _global;
       global_t                   _gstate;
+      state_snapshot             _gstate_snapshot;
       globalloan_singleton       _globalloan;
       globalloan_t               _gloan;
+      state_snapshot             _gloan_snapshot;
 
       dbc                        _db;
       global_state::ptr_t        _global_state;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+#include <eosio/action.hpp>
+#include <eosio/binary_extension.hpp>
+
+namespace tychefi {
+
+using namespace eosio;
+
+//tyche.loan 的 global 表, 仅用于读取借贷侧资金状况, 字段须与 tyche.loan 保持一致
+struct loan_global_t {
+    name                admin;
+    name                lp_refueler;
+    name                price_oracle_contract;
+
+    extended_symbol     loan_token;
+    asset               min_deposit_amount;
+    uint64_t            term_interval_days;
+
+    uint64_t            liquidation_penalty_ratio;
+    uint64_t            liquidation_price_ratio;
+
+    asset               total_principal_quant;                         //总本金
+    asset               avl_principal_quant;                           //可用本金
+    name                tyche_proxy_contract;
+    asset               total_interest_quant;
+
+    bool                enabled;
+    binary_extension<uint64_t> max_price_age_sec;                      //价格最长有效秒数
+
+    EOSLIB_SERIALIZE( loan_global_t, (admin)(lp_refueler)(price_oracle_contract)
+                                (loan_token)(min_deposit_amount)(term_interval_days)
+                                (liquidation_penalty_ratio)(liquidation_price_ratio)
+                                (total_principal_quant)(avl_principal_quant)
+                                (tyche_proxy_contract)(total_interest_quant)
+                                (enabled)(max_price_age_sec) )
+};
+typedef eosio::singleton< "global"_n, loan_global_t > loan_global_singleton;
+
+class tyche_loan {
+   public:
+      //借贷侧资金经 proxy 返还给 earn
+      [[eosio::action]]
+      void sendtoearn( const asset& quant );
+
+      using sendtoearn_action    = eosio::action_wrapper<"sendtoearn"_n, &tyche_loan::sendtoearn>;
+};
+} //namespace tychefi
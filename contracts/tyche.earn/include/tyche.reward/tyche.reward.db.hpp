@@ -6,7 +6,7 @@
 #include <eosio/system.hpp>
 #include <eosio/time.hpp>
 
-#include <utils.hpp>
+#include <tyche.common/utils.hpp>
 
 // #include <deque>
 #include <optional>
@@ -1,194 +0,0 @@
-#pragma once
-
-#include <string>
-#include <algorithm>
-#include <iterator>
-#include <eosio/eosio.hpp>
-#include <eosio/asset.hpp>
-
-#include "safe.hpp"
-#include "errno.h"
-
-using namespace std;
-
-#define EMPTY_MACRO_FUNC(...)
-
-#define PP(prop) "," #prop ":", prop
-#define PP0(prop) #prop ":", prop
-#define PRINT_PROPERTIES(...) eosio::print("{", __VA_ARGS__, "}")
-
-#define CHECK(exp, msg) { if (!(exp)) eosio::check(false, msg); }
-
-#ifndef ASSERT
-    #define ASSERT(exp) CHECK(exp, #exp)
-#endif
-
-#ifdef PRINT_TRACE
-    #warning "PRINT_TRACE should be used for test!!!"
-    #define TRACE(...) print(__VA_ARGS__)
-#else
-    #define TRACE(...)
-#endif
-
-#define TRACE_L(...) TRACE(__VA_ARGS__, "\n")
-
-
-template<typename T>
-int128_t multiply(int128_t a, int128_t b) {
-    int128_t ret = a * b;
-    CHECK(ret >= std::numeric_limits<T>::min() && ret <= std::numeric_limits<T>::max(),
-          "overflow exception of multiply");
-    return ret;
-}
-
-template<typename T>
-int128_t divide_decimal(int128_t a, int128_t b, int128_t precision) {
-    // with rounding-off method
-    int128_t tmp = 10 * a * precision  / b;
-    CHECK(tmp >= std::numeric_limits<T>::min() && tmp <= std::numeric_limits<T>::max(),
-          "overflow exception of divide_decimal");
-    return (tmp + 5) / 10;
-}
-
-template<typename T>
-int128_t multiply_decimal(int128_t a, int128_t b, int128_t precision) {
-    // with rounding-off method
-    int128_t tmp = 10 * a * b / precision;
-    CHECK(tmp >= std::numeric_limits<T>::min() && tmp <= std::numeric_limits<T>::max(),
-          "overflow exception of multiply_decimal");
-    return (tmp + 5) / 10;
-}
-
-#define divide_decimal64(a, b, precision) divide_decimal<int64_t>(a, b, precision)
-#define multiply_decimal64(a, b, precision) multiply_decimal<int64_t>(a, b, precision)
-#define multiply_i64(a, b) multiply<int64_t>(a, b)
-
-
-inline constexpr int64_t power(int64_t base, int64_t exp) {
-    int64_t ret = 1;
-    while( exp > 0  ) {
-        ret *= base; --exp;
-    }
-    return ret;
-}
-
-inline constexpr int64_t power10(int64_t exp) {
-    return power(10, exp);
-}
-
-inline constexpr int64_t calc_precision(int64_t digit) {
-    return power10(digit);
-}
-
-string_view trim(string_view sv) {
-    sv.remove_prefix(std::min(sv.find_first_not_of(" "), sv.size())); // left trim
-    sv.remove_suffix(std::min(sv.size()-sv.find_last_not_of(" ")-1, sv.size())); // right trim
-    return sv;
-}
-
-std::vector<std::string> split(const std::string& s, const std::string& delimiter) {
-    std::vector<std::string> result;
-    size_t pos_start = 0, pos_end;
-    auto delim_len = delimiter.length();
-    while ((pos_end = s.find(delimiter, pos_start)) != std::string::npos) {
-        result.emplace_back(s.substr(pos_start, pos_end - pos_start));
-        pos_start = pos_end + delim_len;
-    }
-    result.emplace_back(s.substr(pos_start));
-    return result;
-}
-
-
-bool starts_with(string_view sv, string_view s) {
-    return sv.size() >= s.size() && sv.compare(0, s.size(), s) == 0;
-}
-
-int64_t to_int64(string_view s, const char* err_title) {
-    errno = 0;
-    uint64_t ret = std::strtoll(s.data(), nullptr, 10);
-    CHECK(errno == 0, string(err_title) + ": convert str to int64 error: " + std::strerror(errno));
-    return ret;
-}
-
-uint64_t to_uint64(string_view s, const char* err_title) {
-    errno = 0;
-    uint64_t ret = std::strtoull(s.data(), nullptr, 10);
-    CHECK(errno == 0, string(err_title) + ": convert str to uint64 error: " + std::strerror(errno));
-    return ret;
-}
-
-template <class T>
-void precision_from_decimals(int8_t decimals, T& p10)
-{
-    CHECK(decimals <= 18, "symbol precision should be <= 18");
-    p10 = 1;
-    T p = decimals;
-    while( p > 0  ) {
-        p10 *= 10; --p;
-    }
-}
-
-static symbol symbol_from_string(string_view from)
-{
-    string_view s = trim(from);
-    CHECK(!s.empty(), "creating symbol from empty string");
-    auto comma_pos = s.find(',');
-    CHECK(comma_pos != string::npos, "missing comma in symbol");
-    auto prec_part = s.substr(0, comma_pos);
-    uint64_t p = to_uint64(prec_part, "symbol");
-    string_view name_part = s.substr(comma_pos + 1);
-    CHECK( p <= 18, "symbol precision should be <= 18");
-    return symbol(name_part, p);
-}
-
-asset asset_from_string(string_view from)
-{
-    string_view s = trim(from);
-
-    // Find space in order to split amount and symbol
-    auto space_pos = s.find(' ');
-    CHECK(space_pos != string::npos, "Asset's amount and symbol should be separated with space");
-    auto symbol_str = trim(s.substr(space_pos + 1));
-    auto amount_str = s.substr(0, space_pos);
-
-    // Ensure that if decimal point is used (.), decimal fraction is specified
-    auto dot_pos = amount_str.find('.');
-    if (dot_pos != string::npos) {
-        CHECK(dot_pos != amount_str.size() - 1, "Missing decimal fraction after decimal point");
-    }
-
-    // Parse symbol
-    uint8_t precision_digit = 0;
-    if (dot_pos != string::npos) {
-        precision_digit = amount_str.size() - dot_pos - 1;
-    }
-
-    symbol sym = symbol(symbol_str, precision_digit);
-
-    // Parse amount
-    safe<int64_t> int_part, fract_part;
-    if (dot_pos != string::npos) {
-        int_part = to_int64(amount_str.substr(0, dot_pos), "asset");
-        fract_part = to_uint64(amount_str.substr(dot_pos + 1), "asset");
-        if (amount_str[0] == '-') fract_part *= -1;
-    } else {
-        int_part = to_int64(amount_str, "asset");
-    }
-
-    safe<int64_t> amount = int_part;
-    safe<int64_t> precision; precision_from_decimals(sym.precision(), precision);
-    amount *= precision;
-    amount += fract_part;
-
-    return asset(amount.value, sym);
-}
-
-uint128_t make128key(uint64_t a, uint64_t b) {
-    uint128_t aa = a;
-    uint128_t bb = b;
-    return (aa << 64) + bb;
-}
-
-checksum256 make256key(uint64_t a, uint64_t b, uint64_t c, uint64_t d) {
-    return checksum256::make_from_word_sequence<uint64_t>(a,b,c,d);
-}
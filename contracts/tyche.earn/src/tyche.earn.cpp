@@ -1,9 +1,11 @@
 #include <tyche.earn/tyche.earn.hpp>
 #include <tyche.reward/tyche.reward.hpp>
-#include <flon.token.hpp>
+#include <tyche.loan/tyche.loan.hpp>
+#include <tyche.common/flon.token.hpp>
 
-#include "safemath.hpp"
-#include <utils.hpp>
+#include <tyche.common/safemath.hpp>
+#include <tyche.common/utils.hpp>
+#include <tyche.common/memo.hpp>
 // #include <eosiolib/time.hpp>
 #include <eosio/time.hpp>
 #include<tyche.reward/tyche.reward.db.hpp>
@@ -32,14 +34,14 @@ inline static int128_t calc_reward_per_share_delta( const asset& rewards, const
    ASSERT(rewards.amount >= 0 && total_shares.amount >= 0);
    int128_t new_reward_per_share_delta = 0;
    if (rewards.amount > 0 && total_shares.amount > 0) {
-      new_reward_per_share_delta = rewards.amount * HIGH_PRECISION / total_shares.amount;
+      new_reward_per_share_delta = wad::from_ratio( rewards.amount, total_shares.amount ).raw;
    }
    return new_reward_per_share_delta;
 }
 // 根据用户的votes和reward_per_share_delta来计算用户的rewards
 inline static asset calc_sharer_rewards(const asset& earner_shares, const int128_t& reward_per_share_delta, const symbol& rewards_symbol) {
    ASSERT( earner_shares.amount >= 0 && reward_per_share_delta >= 0 );
-   int128_t rewards = earner_shares.amount * reward_per_share_delta / HIGH_PRECISION;
+   int128_t rewards = wad::from_raw( reward_per_share_delta ).times( earner_shares.amount );
    // rewards = rewards * get_precision(rewards_symbol)/get_precision(earner_shares.symbol);
    CHECK( rewards >= 0 && rewards <= std::numeric_limits<int64_t>::max(), "calculated rewards overflow" );
    return asset( (int64_t)rewards, rewards_symbol );
@@ -60,7 +62,7 @@ void tyche_earn::init(const name& admin, const name& reward_contract, const name
  * @param to
  * @param quantity
  * @param memo: two formats:
- *       1) redeem:$code - upon transferring in TRUSD to withdraw
+ *       1) redeem:$code[,$code...] - upon transferring in TRUSD to withdraw one or more terms
  *       2) deposit:$code  - codes: 1,30,90,180,360
  */
 void tyche_earn::ontransfer(const name& from, const name& to, const asset& quant, const string& memo) {
@@ -75,12 +77,16 @@ void tyche_earn::ontransfer(const name& from, const name& to, const asset& quant
       if(from == _gstate.lp_refueler) //充入TRUSD到合约
          return;
 
-      auto params = split(memo, ":");
-      CHECKC( params.size() == 2 && params[0] == "redeem", err::MEMO_FORMAT_ERROR, "redeem memo format error" )
+      memo_reader params(memo, ':', (uint8_t)err::MEMO_FORMAT_ERROR);
+      CHECKC( params.next() == "redeem", err::MEMO_FORMAT_ERROR, "redeem memo format error" )
 
-      //用户提取奖励和本金
-      auto term_code = (uint64_t) stoi(string(params[1]));
-      onredeem(from, term_code, quant );
+      //用户提取奖励和本金, 可一次赎回多个池子: redeem:30,90,180
+      memo_reader codes(params.next(), ',', (uint8_t)err::MEMO_FORMAT_ERROR);
+      params.end();
+      std::vector<uint64_t> term_codes;
+      while( !codes.done() )
+         term_codes.push_back( codes.next_uint64() );
+      onredeem(from, term_codes, quant );
       return;
    }
 
@@ -89,11 +95,16 @@ void tyche_earn::ontransfer(const name& from, const name& to, const asset& quant
       _gloan.loan_quant -= quant;
       return;
    }
+   //复投的利息转入
+   if(from == _gstate.reward_contract && quant.symbol == _gstate.principal_token.get_symbol() && token_bank == _gstate.principal_token.get_contract() ) {
+      return;
+   }
 
-   auto params = split(memo, ":");
+   memo_reader params(memo, ':', (uint8_t)err::MEMO_FORMAT_ERROR);
    //用户充入本金
-   if(params.size() == 2 && params[0] == "deposit" && quant.symbol == _gstate.principal_token.get_symbol()) {
-      auto term_code = (uint64_t) stoi(string(params[1]));
+   if(params.next() == "deposit" && quant.symbol == _gstate.principal_token.get_symbol()) {
+      auto term_code = params.next_uint64();
+      params.end();
       ondeposit(from, term_code, quant);
       return;
    }
@@ -121,6 +132,7 @@ void tyche_earn::refuelintrst( const name& token_bank, const asset& total_reward
    auto pool_itr        = pools.begin();
    CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "save plan not found" )
 
+   //total_share 须在分配前汇总, 不能分批; 池子数受 MAX_EARN_POOLS 限制
    uint64_t total_share = 0;
    while( pool_itr != pools.end()) {
       if(pool_itr->on_shelf)
@@ -137,9 +149,8 @@ void tyche_earn::refuelintrst( const name& token_bank, const asset& total_reward
       auto rewards = asset(total_rewards.amount * rate / PCT_BOOST, total_rewards.symbol);
       auto new_reward_id = _global_state->new_reward_id();
       if( rewards.amount > 0) {
-         auto last_reward = pool_itr->interest_reward;
-
          pools.modify( pool_itr, _self, [&]( auto& c ) {
+            auto& last_reward                         = c.interest_reward;
             last_reward.reward_id                     = new_reward_id;
             last_reward.total_rewards                 += rewards;
             last_reward.last_rewards                  = rewards;
@@ -148,7 +159,6 @@ void tyche_earn::refuelintrst( const name& token_bank, const asset& total_reward
             last_reward.reward_per_share              = last_reward.reward_per_share + calc_reward_per_share_delta(rewards, pool_itr->avl_principal);
             last_reward.prev_reward_added_at          = last_reward.reward_added_at;
             last_reward.reward_added_at               = now;
-            c.interest_reward                         = last_reward;
          });
       }
       pool_itr++;
@@ -172,8 +182,8 @@ void tyche_earn::refuelreward_to_pool( const name& token_bank, const asset& tota
 
 
          auto count =  c.airdrop_rewards.count(total_rewards.symbol);
+         auto& reward                              = c.airdrop_rewards[ total_rewards.symbol ];
          if(count == 0 ){
-            auto reward =   earn_pool_reward_st();
             reward.reward_id                       = _global_state->new_reward_id();
             reward.total_rewards                   = total_rewards;
             reward.last_rewards                    = total_rewards;
@@ -184,9 +194,7 @@ void tyche_earn::refuelreward_to_pool( const name& token_bank, const asset& tota
             reward.reward_per_share                = calc_reward_per_share_delta(total_rewards, pool_itr->avl_principal);
             reward.prev_reward_added_at            = current_time_point();
             reward.reward_added_at                 = current_time_point();
-            c.airdrop_rewards[ total_rewards.symbol ] = reward;
          } else {
-            auto  reward                           =  c.airdrop_rewards[ total_rewards.symbol ];
             reward.reward_id                       = _global_state->new_reward_id();
             reward.total_rewards                   += total_rewards;
             reward.last_rewards                    = total_rewards;
@@ -195,8 +203,6 @@ void tyche_earn::refuelreward_to_pool( const name& token_bank, const asset& tota
             reward.reward_per_share                = reward.reward_per_share + calc_reward_per_share_delta(total_rewards, pool_itr->avl_principal);
             reward.prev_reward_added_at            = reward.reward_added_at;
             reward.reward_added_at                 = current_time_point();
-            c.airdrop_rewards[ total_rewards.symbol ] = reward;
-
          }
    });
 }
@@ -214,6 +220,7 @@ void tyche_earn::refuelreward_to_all( const name& token_bank, const asset& total
    auto pools           = earn_pool_t::tbl_t(_self, _self.value);
    auto pool_itr        = pools.begin();
    CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "save plan not found" )
+   //total_share 须在分配前汇总, 不能分批; 池子数受 MAX_EARN_POOLS 限制
    while( pool_itr != pools.end() ) {
       if( pool_itr->on_shelf ) {
           total_share += pool_itr->share_multiplier * pool_itr->avl_principal.amount;
@@ -232,7 +239,7 @@ void tyche_earn::refuelreward_to_all( const name& token_bank, const asset& total
       auto new_reward_id                      = _global_state->new_reward_id();
       if(pool_itr->airdrop_rewards.count(total_rewards.symbol) == 0) {
          pools.modify( pool_itr, _self, [&]( auto& c ) {
-            auto reward = earn_pool_reward_st();
+            auto& reward                      = c.airdrop_rewards[total_rewards.symbol];
             reward.reward_id                  = new_reward_id;
             reward.total_rewards              = rewards;
             reward.last_rewards               = rewards;
@@ -242,13 +249,11 @@ void tyche_earn::refuelreward_to_all( const name& token_bank, const asset& total
             reward.last_reward_per_share      = 0;
             reward.reward_per_share           = calc_reward_per_share_delta(rewards, pool_itr->avl_principal);
             reward.reward_added_at            = now;
-
-            c.airdrop_rewards[total_rewards.symbol] = reward;
          });
 
       } else if( rewards.amount > 0) {
          pools.modify( pool_itr, _self, [&]( auto& c ) {
-            auto reward                         = pool_itr->airdrop_rewards.at(rewards.symbol);
+            auto& reward                        = c.airdrop_rewards.at(rewards.symbol);
             reward.reward_id                    = new_reward_id;
             reward.total_rewards                += rewards;
             reward.last_rewards                 = rewards;
@@ -257,8 +262,6 @@ void tyche_earn::refuelreward_to_all( const name& token_bank, const asset& total
             reward.reward_per_share             = reward.reward_per_share + calc_reward_per_share_delta(rewards, pool_itr->avl_principal);
             reward.prev_reward_added_at         = reward.reward_added_at;
             reward.reward_added_at              = now;
-
-            c.airdrop_rewards[total_rewards.symbol] = reward;
          });
       }
       pool_itr++;
@@ -271,19 +274,20 @@ void tyche_earn::ondeposit( const name& from, const uint64_t& term_code, const a
    auto now = time_point_sec(current_time_point());
    CHECKC( _gstate.enabled, err::PAUSED, "not effective yet" )
 
-   auto pools              = earn_pool_t::tbl_t(_self, _self.value);
+   auto& pools             = _db.cache<earn_pool_t>(_self.value);
    auto pool_itr           = pools.find( term_code );
-   CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
+   CHECKC( pool_itr != nullptr, err::RECORD_NOT_FOUND, "earn pool not found" )
 
-   auto accts              = earner_t::tbl_t(_self, term_code);
+   auto& accts             = _db.cache<earner_t>(term_code);
    auto acct               = accts.find( from.value );
-   if( acct == accts.end() ) {
-      pools.modify( pool_itr, _self, [&]( auto& c ) {
+   auto compounded         = asset(0, quant.symbol);
+   if( acct == nullptr ) {
+      pools.modify( term_code, [&]( auto& c ) {
          c.cum_principal            += quant;
          c.avl_principal            += quant;
       });
 
-      acct = accts.emplace( _self, [&]( auto& a ) {
+      acct = &accts.emplace( [&]( auto& a ) {
          a.owner                 = from;
          a.avl_principal         = quant;
          a.cum_principal         = quant;
@@ -292,104 +296,316 @@ void tyche_earn::ondeposit( const name& from, const uint64_t& term_code, const a
          a.term_started_at       = now;
          a.term_ended_at         = now + pool_itr->term_interval_sec;
          a.created_at            = now;
+         a.maturity_counted      = true;
       });
+      _add_term_code( from, term_code );
+      _add_maturity( acct->term_ended_at, quant.amount );
 
    } else {
       //当用户充入本金, 要结算充入池子的用户之前的利息，同时要修改充入池子的基本信息
-      //循环结算每一种利息代币
-      earn_pool_reward_map pool_airdrop_rewards       = pool_itr->airdrop_rewards;
-      earner_reward_map    earner_airdrop_rewards     = acct->airdrop_rewards;
-      auto older_deposit_quant                        = acct->avl_principal;
-      //结算奖励
-      for (auto& pool_airdrop_rewards_kv : pool_itr->airdrop_rewards) { //for循环每一个token
-         auto pool_airdrop_reward   = pool_airdrop_rewards_kv.second;
-         auto code                  = pool_airdrop_rewards_kv.first;
-         auto earner_airdrop_reward = earner_reward_st();
-         auto new_rewards           = asset(0, pool_airdrop_reward.total_rewards.symbol);
-         //初始化earner_reward 信息
-         if(acct->airdrop_rewards.count(code)) {
-            earner_airdrop_reward   = acct->airdrop_rewards.at(code);
-         } else {
-            earner_airdrop_reward.unclaimed_rewards         = asset(0, pool_airdrop_reward.total_rewards.symbol);
-            earner_airdrop_reward.claimed_rewards           = asset(0, pool_airdrop_reward.total_rewards.symbol);
-            earner_airdrop_reward.total_claimed_rewards     = asset(0, pool_airdrop_reward.total_rewards.symbol);
-            earner_airdrop_reward.last_reward_per_share     = 0; //如果没有，说明此用户在奖励前质押的
-         }
+      //池子与用户各 modify 一次, 奖励信息按引用原地结算
+      auto older_deposit_quant = acct->avl_principal;
+      auto older_ended_at      = acct->term_ended_at;
+      auto compound            = _is_auto_compound( from );
+      accts.modify( from.value, [&]( auto& a ) {
+         pools.modify( term_code, [&]( auto& c ) {
+            //结算奖励, 循环结算每一种代币
+            for( auto& [code, pool_airdrop_reward] : c.airdrop_rewards ) {
+               //如果没有，说明此用户在奖励前质押的, last_reward_per_share 为 0
+               auto& earner_airdrop_reward      = _get_earner_reward(a.airdrop_rewards, code);
+               int128_t reward_per_share_delta  = pool_airdrop_reward.reward_per_share - earner_airdrop_reward.last_reward_per_share;
+               if ( reward_per_share_delta > 0 ) {
+                  auto new_rewards = calc_sharer_rewards(older_deposit_quant, reward_per_share_delta, pool_airdrop_reward.total_rewards.symbol);
+                  pool_airdrop_reward.unalloted_rewards          -= new_rewards;
+                  pool_airdrop_reward.unclaimed_rewards          += new_rewards;
+                  earner_airdrop_reward.last_reward_per_share    = pool_airdrop_reward.reward_per_share;
+                  earner_airdrop_reward.unclaimed_rewards        += new_rewards;
+               }
+            }
+
+            //结算利息
+            auto& pool_interest_reward                   = c.interest_reward;
+            auto& earner_interest_reward                 = a.interest_reward;
+            int128_t reward_per_share_delta              = pool_interest_reward.reward_per_share - earner_interest_reward.last_reward_per_share;
+            auto new_rewards                             = calc_sharer_rewards(older_deposit_quant, reward_per_share_delta, pool_interest_reward.total_rewards.symbol);
+            CHECKC(new_rewards.amount >= 0, err::INCORRECT_AMOUNT,  "new reward must be positive")
+            pool_interest_reward.unalloted_rewards       -= new_rewards;
+            pool_interest_reward.unclaimed_rewards       += new_rewards;
+            earner_interest_reward.last_reward_per_share = pool_interest_reward.reward_per_share;
+            earner_interest_reward.unclaimed_rewards     += new_rewards;
+            //复投: 按领取记账, 利息与本次存款一起计入本金
+            if( compound )
+               compounded                                = _update_reward_info(pool_interest_reward, earner_interest_reward, older_deposit_quant, false);
+
+            c.cum_principal               += quant + compounded;
+            c.avl_principal               += quant + compounded;
+         });
 
-         int128_t reward_per_share_delta = pool_airdrop_reward.reward_per_share - earner_airdrop_reward.last_reward_per_share;
-         if ( reward_per_share_delta > 0 ) {
-            new_rewards = calc_sharer_rewards(older_deposit_quant, reward_per_share_delta, pool_airdrop_reward.total_rewards.symbol);
-            // CHECKC(false, err::ACCOUNT_INVALID, "rewards error: " + new_rewards.to_string())
-            pool_airdrop_reward.unalloted_rewards          -= new_rewards;
-            pool_airdrop_reward.unclaimed_rewards          += new_rewards;
-            earner_airdrop_reward.last_reward_per_share    = pool_airdrop_reward.reward_per_share;
-            earner_airdrop_reward.unclaimed_rewards        += new_rewards;
+         if( a.avl_principal.amount == 0 ) {
+            a.created_at               = now;
          }
-         pool_airdrop_rewards[code]                         = pool_airdrop_reward;
-         earner_airdrop_rewards[code]                       = earner_airdrop_reward;
-      }
+         a.cum_principal               += quant + compounded;
+         a.avl_principal               += quant + compounded;
+         a.term_started_at             = now;
+         a.term_ended_at               = now + pool_itr->term_interval_sec;
+         //整笔本金随新周期顺延到期
+         _move_maturity( a, older_ended_at, older_deposit_quant.amount );
+      });
+   }
+   _compound_interest( compounded, to_string(term_code) );
+   //transfer nusdt to earner, 复投利息对应的 TRUSD 一并发放
+   TRANSFER( _gstate.lp_token.get_contract(), from, asset(quant.amount + compounded.amount, _gstate.lp_token.get_symbol()), "deposit credential:" + to_string(term_code)  )
 
-      auto earner_interest_reward                           = acct->interest_reward;
-      auto pool_interest_reward                             = pool_itr->interest_reward;
-      //结算利息
-      {
-         int128_t reward_per_share_delta              = pool_interest_reward.reward_per_share - earner_interest_reward.last_reward_per_share;
-         auto new_rewards                             = calc_sharer_rewards(older_deposit_quant, reward_per_share_delta, pool_interest_reward.total_rewards.symbol);
-         CHECKC(new_rewards.amount >= 0, err::INCORRECT_AMOUNT,  "new reward must be positive")
-         pool_interest_reward.unalloted_rewards       -= new_rewards;
-         pool_interest_reward.unclaimed_rewards       += new_rewards;
-         earner_interest_reward.last_reward_per_share = pool_interest_reward.reward_per_share;
-         earner_interest_reward.unclaimed_rewards     += new_rewards;
-      }
+}
 
-      pools.modify( pool_itr, _self, [&]( auto& c ) {
-         c.cum_principal               += quant;
-         c.avl_principal               += quant;
-         c.interest_reward             = pool_interest_reward;
-         c.airdrop_rewards             = pool_airdrop_rewards;
+//用户提款只能按全额来提款
+void tyche_earn::onredeem( const name& from, const std::vector<uint64_t>& term_codes, const asset& quant ){
+   auto& pools       = _db.cache<earn_pool_t>(_self.value);
+   auto now          = current_time_point();
+   int64_t total_principal = 0;
+   int64_t tyche_principal = 0;
+   for( size_t i = 0; i < term_codes.size(); i++ ) {
+      auto term_code = term_codes[i];
+      CHECKC( std::find( term_codes.begin(), term_codes.begin() + i, term_code ) == term_codes.begin() + i,
+              err::PARAM_ERROR, "duplicate term code: " + to_string(term_code) )
+
+      CHECKC( pools.find( term_code ) != nullptr, err::RECORD_NOT_FOUND, "earn pool not found" )
+
+      auto acct         = _db.cache<earner_t>(term_code).find( from.value );
+      CHECKC( acct != nullptr, err::RECORD_NOT_FOUND, "account not found" )
+      CHECKC(acct->avl_principal.amount !=0, err::PLAN_INEFFECTIVE, "already redeemed" )
+      CHECKC(acct->term_ended_at <= now, err::TIME_PREMATURE, "premature to redeedm" )
+
+      total_principal   += acct->avl_principal.amount;
+      if( acct->maturity_counted.value_or(false) )
+         _add_maturity( acct->term_ended_at, -acct->avl_principal.amount );
+      if( term_code == _gstate.tyche_reward_pool_code )
+         tyche_principal = acct->avl_principal.amount;
+   }
+   CHECKC(total_principal == quant.amount, err::INCORRECT_AMOUNT, "insufficient deposit amount" )
+
+   //所有池子的奖励/利息汇总后一起发放
+   string codes_memo;
+   reward_payouts rewards;
+   asset interest(0, MUSDT);
+   for( auto& term_code : term_codes ) {
+      _claim_pool_rewards(from, term_code, true, rewards, interest);
+      codes_memo += (codes_memo.empty() ? "" : ",") + to_string(term_code);
+   }
+   _pay_rewards(from, rewards, interest, codes_memo);
+
+   //打出本金MUSDT
+   TRANSFER( MUSDT_BANK, from, asset(quant.amount, MUSDT), "redeem:" + codes_memo )
+   if( tyche_principal > 0 ) {
+      //打出TYCHE
+      auto tyche_amount = tyche_principal * _gstate.tyche_farm_lock_ratio / PCT_BOOST * (get_precision(TYCHE)/get_precision(_gstate.principal_token.get_symbol()));
+      TRANSFER( TYCHE_BANK, from, asset(tyche_amount, TYCHE), "redeem:" + codes_memo )
+   }
+
+   for( auto& term_code : term_codes ) {
+      auto& accts    = _db.cache<earner_t>(term_code);
+      if( _try_retire_earner( term_code, *accts.find( from.value ) ) )
+         accts.erase( from.value );
+   }
+}
+
+bool tyche_earn::_try_retire_earner( const uint64_t& term_code, const earner_t& acct ) {
+   if( acct.avl_principal.amount != 0 || acct.interest_reward.unclaimed_rewards.amount != 0 ) return false;
+   for( const auto& kv : acct.airdrop_rewards ) {
+      if( kv.second.unclaimed_rewards.amount != 0 ) return false;
+   }
+
+   auto& summaries      = _db.cache<earner_summary_t>(_self.value);
+   auto summary         = summaries.find( acct.owner.value );
+   auto fold            = [&]( auto& s ) {
+      if( s.term_codes.has_value() ) {
+         auto& codes             = s.term_codes.value();
+         codes.erase( std::remove( codes.begin(), codes.end(), term_code ), codes.end() );
+      }
+      s.cum_principal            += acct.cum_principal;
+      s.total_claimed_interest   += acct.interest_reward.total_claimed_rewards;
+      for( const auto& [sym, reward] : acct.airdrop_rewards ) {
+         s.total_claimed_rewards.try_emplace( sym, 0, sym ).first->second += reward.total_claimed_rewards;
+      }
+   };
+   if( summary == nullptr ) {
+      summaries.emplace( [&]( auto& s ) {
+         s.owner                 = acct.owner;
+         fold( s );
       });
+   } else {
+      summaries.modify( acct.owner.value, fold );
+   }
+   return true;
+}
 
-      accts.modify( acct, _self,  [&]( auto& c ) {
-         if( c.avl_principal.amount == 0 ) {
-            c.created_at               = now;
-         }
-         c.cum_principal               += quant;
-         c.avl_principal               += quant;
-         c.airdrop_rewards             = earner_airdrop_rewards;
-         c.interest_reward             = earner_interest_reward;
-         c.term_started_at             = now;
-         c.term_ended_at               = now + pool_itr->term_interval_sec;
+std::vector<uint64_t> tyche_earn::_get_term_codes( const name& owner, const bool& backfill ) {
+   auto& summaries      = _db.cache<earner_summary_t>(_self.value);
+   auto summary         = summaries.find( owner.value );
+   if( summary != nullptr && summary->term_codes.has_value() )
+      return summary->term_codes.value();
+
+   //老用户: 扫描一次全部池子补建索引
+   std::vector<uint64_t> codes;
+   auto pools           = earn_pool_t::tbl_t(_self, _self.value);
+   for( auto pool_itr = pools.begin(); pool_itr != pools.end(); pool_itr++ ) {
+      if( _db.cache<earner_t>(pool_itr->code).find( owner.value ) != nullptr )
+         codes.push_back( pool_itr->code );
+   }
+
+   if( !backfill ) return codes;
+   if( summary == nullptr ) {
+      summaries.emplace( [&]( auto& s ) {
+         s.owner        = owner;
+         s.term_codes   = codes;
+      });
+   } else {
+      summaries.modify( owner.value, [&]( auto& s ) {
+         s.term_codes   = codes;
       });
    }
-   //transfer nusdt to earner
-   TRANSFER( _gstate.lp_token.get_contract(), from, asset(quant.amount, _gstate.lp_token.get_symbol()), "deposit credential:" + to_string(term_code)  )
+   return codes;
+}
 
+void tyche_earn::_add_term_code( const name& owner, const uint64_t& term_code ) {
+   auto codes           = _get_term_codes( owner );
+   auto pos             = std::lower_bound( codes.begin(), codes.end(), term_code );
+   if( pos != codes.end() && *pos == term_code ) return;
+   codes.insert( pos, term_code );
+
+   _db.cache<earner_summary_t>(_self.value).modify( owner.value, [&]( auto& s ) {
+      s.term_codes      = codes;
+   });
 }
 
-//用户提款只能按全额来提款
-void tyche_earn::onredeem( const name& from, const uint64_t& term_code, const asset& quant ){
-   auto pools        = earn_pool_t::tbl_t(_self, _self.value);
-   auto pool_itr     = pools.find( term_code );
+template<typename Fn>
+void tyche_earn::_run_earner_batch( const name& task, const uint64_t& code, const name& start, const uint32_t& max_rows, Fn&& fn ) {
+   CHECKC( max_rows > 0, err::PARAM_ERROR, "max_rows must be positive" )
+
+   auto cursors         = maint_cursor_t::tbl_t(_self, code);
+   auto cursor          = cursors.find( task.value );
+   auto from            = start;
+   if( from.value == 0 && cursor != cursors.end() )
+      from              = cursor->next_owner;
+
+   auto accts           = earner_t::tbl_t(_self, code);
+   auto acct            = accts.lower_bound( from.value );
+   uint32_t rows        = 0;
+   for( ; rows < max_rows && acct != accts.end(); rows++ ) {
+      auto next         = std::next( acct );
+      fn( accts, acct );
+      acct              = next;
+   }
+
+   if( acct == accts.end() ) {
+      if( cursor != cursors.end() ) cursors.erase( cursor );
+      return;
+   }
+   auto set_cursor      = [&]( auto& c ) {
+      c.task            = task;
+      c.next_owner      = acct->owner;
+      c.processed       += rows;
+      c.updated_at      = current_time_point();
+   };
+   if( cursor == cursors.end() )
+      cursors.emplace( _self, set_cursor );
+   else
+      cursors.modify( cursor, _self, set_cursor );
+}
+
+void tyche_earn::sweepearner(const uint64_t& code, const name& start, const uint32_t& max_rows) {
+   require_auth(_self);
+   _run_earner_batch( MAINT_SWEEP, code, start, max_rows, [&]( auto& accts, const auto& acct ) {
+      if( _try_retire_earner( code, *acct ) )
+         accts.erase( acct );
+   });
+}
+
+void tyche_earn::batchexpiry(const uint64_t& code, const name& start, const uint32_t& max_rows) {
+   require_auth(_self);
+   auto pools           = earn_pool_t::tbl_t(_self, _self.value);
+   auto pool_itr        = pools.find( code );
    CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
 
-   auto accts        = earner_t::tbl_t(_self, term_code);
-   auto acct         = accts.find( from.value );
-   CHECKC( acct != accts.end(), err::RECORD_NOT_FOUND, "account not found" )
+   _run_earner_batch( MAINT_EXPIRY, code, start, max_rows, [&]( auto& accts, const auto& acct ) {
+      auto term_ended_at   = acct->term_started_at + pool_itr->term_interval_sec;
+      if( acct->term_ended_at == term_ended_at ) return;
+      auto older_ended_at  = acct->term_ended_at;
+      accts.modify( acct, _self, [&]( auto& a ) {
+         a.term_ended_at   = term_ended_at;
+         _move_maturity( a, older_ended_at, a.avl_principal.amount );
+      });
+   });
+}
 
-   auto now          = current_time_point();
-   CHECKC(acct->avl_principal.amount !=0, err::PLAN_INEFFECTIVE, "already redeemed" )
-   CHECKC(acct->avl_principal.amount == quant.amount, err::INCORRECT_AMOUNT, "insufficient deposit amount" )
-   CHECKC(acct->term_ended_at <= now, err::TIME_PREMATURE, "premature to redeedm" )
+void tyche_earn::initmaturity(const uint64_t& code, const name& start, const uint32_t& max_rows) {
+   require_auth(_self);
+   //已计入的行跳过, 可重复执行, 也不会与升级后的存取重复计入
+   _run_earner_batch( MAINT_MATURITY, code, start, max_rows, [&]( auto& accts, const auto& acct ) {
+      if( acct->maturity_counted.value_or(false) ) return;
+      accts.modify( acct, same_payer, [&]( auto& a ) {
+         _move_maturity( a, a.term_ended_at, 0 );
+      });
+   });
+}
 
-   _claim_pool_rewards(from, term_code, true);
+void tyche_earn::migraterows(const uint64_t& code, const name& start, const uint32_t& max_rows) {
+   require_auth(_self);
+   auto pools           = earn_pool_t::tbl_t(_self, _self.value);
+   auto pool_itr        = pools.find( code );
+   CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
+   if( row_version_of( *pool_itr ) < earn_pool_t::ROW_VERSION )
+      pools.modify( pool_itr, same_payer, []( auto& ) {} );
 
-   //打出本金MUSDT
-   TRANSFER( MUSDT_BANK, from, asset(quant.amount, MUSDT), "redeem:" + to_string(term_code) )
-   if(term_code == _gstate.tyche_reward_pool_code) {
-      //打出TYCHE
-      auto tyche_amount = quant.amount * _gstate.tyche_farm_lock_ratio / PCT_BOOST * (get_precision(TYCHE)/get_precision(acct->avl_principal));
-      TRANSFER( TYCHE_BANK, from, asset(tyche_amount, TYCHE), "redeem:" + to_string(term_code) )
+   _run_earner_batch( MAINT_MIGRATE, code, start, max_rows, [&]( auto& accts, const auto& acct ) {
+      if( row_version_of( *acct ) < earner_t::ROW_VERSION )
+         accts.modify( acct, same_payer, []( auto& ) {} );
+   });
+}
+
+void tyche_earn::_move_maturity( earner_t& acct, const time_point_sec& old_ended_at, const int64_t& old_principal ) {
+   auto counted            = acct.maturity_counted.value_or(false);
+   acct.maturity_counted   = true;
+   if( counted && old_ended_at.sec_since_epoch() / DAY_SECONDS == acct.term_ended_at.sec_since_epoch() / DAY_SECONDS ) {
+      _add_maturity( acct.term_ended_at, acct.avl_principal.amount - old_principal );
+      return;
    }
+   if( counted )
+      _add_maturity( old_ended_at, -old_principal );
+   _add_maturity( acct.term_ended_at, acct.avl_principal.amount );
+}
+
+void tyche_earn::_add_maturity( const time_point_sec& ended_at, const int64_t& amount ) {
+   if( amount == 0 ) return;
+   auto& maturities     = _db.cache<maturity_t>(_self.value);
+   auto day             = ended_at.sec_since_epoch() / DAY_SECONDS;
+   auto itr             = maturities.find( day );
+   if( itr == nullptr ) {
+      //只扣减已计入的本金, 不应出现; 兜底
+      if( amount < 0 ) return;
+      maturities.emplace( [&]( auto& m ) {
+         m.day                = day;
+         m.principal          = asset(amount, _gstate.principal_token.get_symbol());
+      });
+      return;
+   }
+   if( itr->principal.amount + amount <= 0 ) {
+      maturities.erase( day );
+      return;
+   }
+   maturities.modify( day, [&]( auto& m ) {
+      m.principal.amount      += amount;
+   });
+}
+
+int64_t tyche_earn::_get_maturing_principal( const uint64_t& horizon_days ) {
+   auto maturities      = maturity_t::tbl_t(_self, _self.value);
+   auto last_day        = current_time_point().sec_since_epoch() / DAY_SECONDS + horizon_days;
+   int64_t principal    = 0;
+   for( auto itr = maturities.begin(); itr != maturities.end() && itr->day <= last_day; itr++ ) {
+      principal         += itr->principal.amount;
+   }
+   return principal;
 }
 
 
@@ -412,6 +628,89 @@ void tyche_earn::addrewardsym(const extended_symbol& sym) {
 }
 //
 
+//清理下架奖励币种, 分两轮按主键遍历池子用户:
+//1) 按池子最终 reward_per_share 结算每个用户并发放; 遍历完成后所有用户均已结算到最终值,
+//   池子剩余的未分配/未领取数额不再属于任何现存用户(取整零头, 或已赎回用户未领取的部分), 随池子记录删除
+//2) 删除已结算到最终值的用户记录
+//清理期间不能重新上架该币种, 避免重建的池子记录与用户旧的 last_reward_per_share 混用
+void tyche_earn::compactrwd(const uint64_t& code, const symbol& sym, const uint32_t& max_rows) {
+   require_auth(_self);
+   CHECKC( max_rows > 0, err::PARAM_ERROR, "max_rows must be positive" )
+
+   auto reward_symbols     = reward_symbol_t::idx_t(_self, _self.value);
+   auto reward_symbol      = reward_symbols.find( sym.code().raw() );
+   CHECKC( reward_symbol != reward_symbols.end(), err::RECORD_NOT_FOUND, "reward symbol not found" )
+   CHECKC( !reward_symbol->on_shelf, err::STATUS_ERROR, "reward symbol still on shelf" )
+
+   auto pools              = earn_pool_t::tbl_t(_self, _self.value);
+   auto pool_itr           = pools.find( code );
+   CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
+
+   auto compacts           = reward_compact_t::tbl_t(_self, sym.code().raw());
+   auto compact            = compacts.find( code );
+   if( compact == compacts.end() ) {
+      auto pool_reward     = pool_itr->airdrop_rewards.find( sym );
+      CHECKC( pool_reward != pool_itr->airdrop_rewards.end(), err::RECORD_NOT_FOUND, "reward symbol not found in pool" )
+      compact              = compacts.emplace( _self, [&]( auto& c ) {
+         c.code                     = code;
+         c.sym                      = sym;
+         c.final_reward_per_share   = pool_reward->second.reward_per_share;
+      });
+   }
+   auto final_rps          = compact->final_reward_per_share;
+
+   auto accts              = earner_t::tbl_t(_self, code);
+   auto acct               = accts.lower_bound( compact->next_owner.value );
+   if( !compact->pool_erased ) {
+      auto pool_reward     = pool_itr->airdrop_rewards.at( sym );
+      for( uint32_t rows = 0; rows < max_rows && acct != accts.end(); rows++, acct++ ) {
+         //没有记录的用户按 last_reward_per_share = 0 结算
+         auto earner_reward = acct->airdrop_rewards.find( sym );
+         auto settled       = earner_reward == acct->airdrop_rewards.end()
+                            ? acct->avl_principal.amount == 0
+                            : earner_reward->second.last_reward_per_share == final_rps && earner_reward->second.unclaimed_rewards.amount == 0;
+         if( settled ) continue;
+
+         asset total;
+         accts.modify( acct, _self, [&]( auto& a ) {
+            total          = _update_reward_info(pool_reward, _get_earner_reward(a.airdrop_rewards, sym), a.avl_principal, false);
+         });
+         if( total.amount > 0 )
+            _pay_rewards(acct->owner, {{ reward_symbol->sym, total }}, asset(0, MUSDT), "compact");
+      }
+      pools.modify( pool_itr, _self, [&]( auto& c ) {
+         if( acct == accts.end() )
+            c.airdrop_rewards.erase( sym );
+         else
+            c.airdrop_rewards.at( sym ) = pool_reward;
+      });
+   } else {
+      for( uint32_t rows = 0; rows < max_rows && acct != accts.end(); rows++, acct++ ) {
+         auto earner_reward = acct->airdrop_rewards.find( sym );
+         if( earner_reward == acct->airdrop_rewards.end() ) continue;
+         CHECKC( earner_reward->second.last_reward_per_share == final_rps && earner_reward->second.unclaimed_rewards.amount == 0,
+                 err::STATUS_ERROR, "earner reward not settled: " + acct->owner.to_string() )
+         accts.modify( acct, _self, [&]( auto& a ) {
+            a.airdrop_rewards.erase( sym );
+         });
+      }
+      if( acct == accts.end() ) {
+         compacts.erase( compact );
+         return;
+      }
+   }
+
+   compacts.modify( compact, _self, [&]( auto& c ) {
+      if( acct == accts.end() ) {
+         c.pool_erased              = true;
+         c.next_owner               = name();
+      } else {
+         c.next_owner               = acct->owner;
+      }
+      c.updated_at                  = current_time_point();
+   });
+}
+
 void tyche_earn::setmindepamt(const asset& quant) {
    require_auth(_self);
    CHECKC(quant.symbol== _gstate.min_deposit_amount.symbol, err::MEMO_FORMAT_ERROR, "symbol error")
@@ -421,180 +720,287 @@ void tyche_earn::setmindepamt(const asset& quant) {
 void tyche_earn::claimrewards(const name& from){
    require_auth(from);
 
-   auto pools        = earn_pool_t::tbl_t(_self, _self.value);
-   auto pool_itr     = pools.begin();
+   auto& pools       = _db.cache<earn_pool_t>(_self.value);
    bool finalclaimed = false;
-   while( pool_itr != pools.end() ) {
-      if( !pool_itr->on_shelf ) { pool_itr++; continue; }
-      auto claimed   = _claim_pool_rewards(from, pool_itr->code, false);
+   reward_payouts rewards;
+   asset interest(0, MUSDT);
+   auto compound     = _is_auto_compound(from);
+   //只遍历用户有持仓的池子; 预算用尽时记录进度, 再次调用从下一个池子继续
+   auto cursor       = continuation<continuation_t::tbl_t>(_self, from.value, CONT_CLAIM);
+   auto resumed      = cursor.pending();
+   work_budget budget( CLAIM_WORK_BUDGET );
+   auto codes        = _get_term_codes(from);
+   auto code_itr     = std::lower_bound( codes.begin(), codes.end(), cursor.next_key() );
+   for( ; code_itr != codes.end(); code_itr++ ) {
+      auto pool_itr  = pools.find( *code_itr );
+      if( pool_itr == nullptr || !pool_itr->on_shelf ) continue;
+      if( !budget.spend( 1 + pool_itr->airdrop_rewards.size() ) ) break;
+      auto claimed   = _claim_pool_rewards(from, *code_itr, false, rewards, interest, compound);
       if (!finalclaimed)
          finalclaimed = claimed;
-
-      pool_itr++;
    }
-   CHECKC(finalclaimed, err::RECORD_NOT_FOUND, "no reward to claim for " + from.to_string() )
+   if( code_itr == codes.end() )
+      cursor.finish();
+   else
+      cursor.save( *code_itr, _self );
+   CHECKC(finalclaimed || resumed || budget.exhausted(), err::RECORD_NOT_FOUND, "no reward to claim for " + from.to_string() )
+   if( !compound ) {
+      _pay_rewards(from, rewards, interest, "all");
+      return;
+   }
+   _pay_rewards(from, rewards, asset(0, MUSDT), "all");
+   _compound_interest(interest, "all");
+   if( interest.amount > 0 )
+      TRANSFER( _gstate.lp_token.get_contract(), from, asset(interest.amount, _gstate.lp_token.get_symbol()), "compound:all" )
+}
+
+void tyche_earn::setcompound( const name& owner, const bool& enabled ) {
+   require_auth(owner);
+   //先建立 term_codes, 保证 binary_extension 字段依次有值
+   _get_term_codes(owner);
+   _db.cache<earner_summary_t>(_self.value).modify( owner.value, [&]( auto& s ) {
+      s.auto_compound   = enabled;
+   });
+}
+
+bool tyche_earn::_is_auto_compound( const name& owner ) {
+   auto summary         = _db.cache<earner_summary_t>(_self.value).find( owner.value );
+   return summary != nullptr && summary->auto_compound.value_or(false);
 }
 
 
 void tyche_earn::claimreward(const name& from, const std::string& sym){
    require_auth(from);
 
-   auto pools        = earn_pool_t::tbl_t(_self, _self.value);
-   auto pool_itr     = pools.begin();
+   auto& pools       = _db.cache<earn_pool_t>(_self.value);
    auto sym_code     = symbol_from_string(sym);
    bool finalclaimed = false;
-   while( pool_itr != pools.end() ) {
-      if( !pool_itr->on_shelf ) { pool_itr++; continue; }
-      auto claimed   = _claim_pool_rewards_by_symbol(from, pool_itr->code, sym_code, false);
+   reward_payouts rewards;
+   asset interest(0, MUSDT);
+   //与 claimrewards 一致: 开启复投时利息计入本金
+   auto compound     = sym_code == MUSDT && _is_auto_compound(from);
+   auto cursor       = continuation<continuation_t::tbl_t>(_self, from.value, CONT_CLAIM_SYM, sym_code.raw());
+   auto resumed      = cursor.pending();
+   work_budget budget( CLAIM_WORK_BUDGET );
+   auto codes        = _get_term_codes(from);
+   auto code_itr     = std::lower_bound( codes.begin(), codes.end(), cursor.next_key() );
+   for( ; code_itr != codes.end(); code_itr++ ) {
+      auto pool_itr  = pools.find( *code_itr );
+      if( pool_itr == nullptr || !pool_itr->on_shelf ) continue;
+      if( !budget.spend() ) break;
+      auto claimed   = _claim_pool_rewards_by_symbol(from, *code_itr, sym_code, false, rewards, interest, compound);
       if (!finalclaimed)
          finalclaimed = claimed;
+   }
+   if( code_itr == codes.end() )
+      cursor.finish();
+   else
+      cursor.save( *code_itr, _self );
+   CHECKC(finalclaimed || resumed || budget.exhausted(), err::RECORD_NOT_FOUND, "no reward to claim for " + from.to_string() )
+   if( !compound ) {
+      _pay_rewards(from, rewards, interest, "all");
+      return;
+   }
+   _pay_rewards(from, rewards, asset(0, MUSDT), "all");
+   _compound_interest(interest, "all");
+   if( interest.amount > 0 )
+      TRANSFER( _gstate.lp_token.get_contract(), from, asset(interest.amount, _gstate.lp_token.get_symbol()), "compound:all" )
+}
 
-      pool_itr++;
+std::vector<earner_pending_st> tyche_earn::getpending( const name& owner ) {
+   auto& reward_symbols    = _db.cache<reward_symbol_t>(_self.value);
+   auto& pools             = _db.cache<earn_pool_t>(_self.value);
+
+   std::vector<earner_pending_st> pendings;
+   for( auto& code : _get_term_codes(owner, false) ) {
+      auto pool_itr        = pools.find( code );
+      if( pool_itr == nullptr ) continue;
+      auto acct            = _db.cache<earner_t>(code).find( owner.value );
+      if( acct == nullptr ) continue;
+
+      earner_pending_st pending;
+      pending.term_code       = code;
+      pending.on_shelf        = pool_itr->on_shelf;
+      pending.avl_principal   = acct->avl_principal;
+      pending.term_ended_at   = acct->term_ended_at;
+
+      //同 _update_reward_info
+      auto& pool_interest     = pool_itr->interest_reward;
+      auto& earner_interest   = acct->interest_reward;
+      pending.interest        = earner_interest.unclaimed_rewards
+                              + calc_sharer_rewards(acct->avl_principal, pool_interest.reward_per_share - earner_interest.last_reward_per_share, pool_interest.total_rewards.symbol);
+
+      for( const auto& [sym, pool_reward] : pool_itr->airdrop_rewards ) {
+         auto reward_symbol_ptr  = reward_symbols.find( sym.code().raw() );
+         if( reward_symbol_ptr == nullptr || !reward_symbol_ptr->on_shelf ) continue;
+
+         int128_t last_reward_per_share  = 0;
+         auto     unclaimed              = asset(0, sym);
+         auto     earner_reward          = acct->airdrop_rewards.find( sym );
+         if( earner_reward != acct->airdrop_rewards.end() ) {
+            last_reward_per_share        = earner_reward->second.last_reward_per_share;
+            unclaimed                    = earner_reward->second.unclaimed_rewards;
+         }
+         auto total = unclaimed + calc_sharer_rewards(acct->avl_principal, pool_reward.reward_per_share - last_reward_per_share, sym);
+         if( total.amount > 0 )
+            pending.rewards.emplace_back( total, reward_symbol_ptr->sym.get_contract() );
+      }
+      pendings.push_back( pending );
    }
-   CHECKC(finalclaimed, err::RECORD_NOT_FOUND, "no reward to claim for " + from.to_string() )
+   return pendings;
 }
 
-bool tyche_earn::_claim_pool_rewards(const name& from, const uint64_t& term_code, const bool& term_end_flag ){
-   auto reward_symbols     = reward_symbol_t::idx_t(_self, _self.value);
+void tyche_earn::_pay_rewards(const name& from, const reward_payouts& rewards, const asset& interest, const string& memo_suffix) {
+   if( !rewards.empty() ) {
+      std::vector<extended_asset> quants;
+      quants.reserve( rewards.size() );
+      for( const auto& [ext_sym, quant] : rewards )
+         quants.emplace_back( quant, ext_sym.get_contract() );
+
+      if( quants.size() == 1 ) {
+         tyche_reward::claimreward_action claim_reward_act(_gstate.reward_contract, { {get_self(), "active"_n} });
+         claim_reward_act.send(from, quants[0].contract, quants[0].quantity, "reward:" + memo_suffix);
+      } else {
+         tyche_reward::claimrewards_action claim_rewards_act(_gstate.reward_contract, { {get_self(), "active"_n} });
+         claim_rewards_act.send(from, quants, "reward:" + memo_suffix);
+      }
+   }
+
+   if( interest.amount > 0 ) {
+      tyche_reward::claimintr_action cliam_interest_act(_gstate.reward_contract, { {get_self(), "active"_n} });
+      cliam_interest_act.send(from, MUSDT_BANK, interest, "interest:" + memo_suffix);
+   }
+}
+
+void tyche_earn::_compound_interest(const asset& interest, const string& memo_suffix) {
+   if( interest.amount <= 0 ) return;
+   tyche_reward::claimintr_action cliam_interest_act(_gstate.reward_contract, { {get_self(), "active"_n} });
+   cliam_interest_act.send(get_self(), MUSDT_BANK, interest, "compound:" + memo_suffix);
+}
+
+bool tyche_earn::_claim_pool_rewards(const name& from, const uint64_t& term_code, const bool& term_end_flag,
+                                     reward_payouts& rewards, asset& interest, const bool& compound ){
+   auto& reward_symbols    = _db.cache<reward_symbol_t>(_self.value);
    bool existed            = false;
 
-   auto now                = time_point_sec(current_time_point());
-   auto pools              = earn_pool_t::tbl_t(_self, _self.value);
-   auto pool_itr           = pools.find( term_code );
-   CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
+   auto& pools             = _db.cache<earn_pool_t>(_self.value);
+   CHECKC( pools.find( term_code ) != nullptr, err::RECORD_NOT_FOUND, "earn pool not found" )
 
-   auto accts  = earner_t::tbl_t(_self, term_code);
+   auto& accts = _db.cache<earner_t>(term_code);
    auto acct   = accts.find( from.value );
-   if(acct == accts.end())
+   if(acct == nullptr)
       return false;
 
-   auto reward_symbol_ptr      = reward_symbols.begin();
-   auto earner_airdrop_rewards   = acct->airdrop_rewards;
-   auto pool_airdrop_rewards     = pool_itr->airdrop_rewards;
-   while(reward_symbol_ptr != reward_symbols.end()) {
-      if(!reward_symbol_ptr->on_shelf) {reward_symbol_ptr++; continue;}
-      auto sym    = reward_symbol_ptr->sym.get_symbol();
-      if( pool_itr->airdrop_rewards.count( sym ) == 0 ) {
-         reward_symbol_ptr++;
-         continue;
-      }
-      earner_reward_st earner_airdrop_reward = {0, asset(0, sym), asset(0,sym), asset(0, sym)};
-      if(acct->airdrop_rewards.count( sym ) > 0) {
-         earner_airdrop_reward   = acct->airdrop_rewards.at(sym);
-      }
-      auto pool_airdrop_reward     = pool_itr->airdrop_rewards.at(sym);
-
+   auto avl_principal = acct->avl_principal;
+   auto compounded    = asset(0, avl_principal.symbol);
+   accts.modify( from.value, [&]( auto& a ) {
+      pools.modify( term_code, [&]( auto& c ) {
+         //只遍历池子已有的奖励币种
+         for( auto& [sym, pool_airdrop_reward] : c.airdrop_rewards ) {
+            auto reward_symbol_ptr = reward_symbols.find( sym.code().raw() );
+            if( reward_symbol_ptr == nullptr || !reward_symbol_ptr->on_shelf ) continue;
+
+            auto& earner_airdrop_reward = _get_earner_reward(a.airdrop_rewards, sym);
+            auto total_rewards          = _update_reward_info(pool_airdrop_reward, earner_airdrop_reward, avl_principal, term_end_flag);
+            //汇总, 由 _pay_rewards 统一发放
+            if(total_rewards.amount > 0) {
+               auto payout = rewards.try_emplace(reward_symbol_ptr->sym, 0, total_rewards.symbol).first;
+               payout->second += total_rewards;
+               existed = true;
+            }
+         }
 
-      auto total_rewards            = _update_reward_info(pool_airdrop_reward, earner_airdrop_reward, acct->avl_principal, term_end_flag);
-      earner_airdrop_rewards[sym]  = earner_airdrop_reward;
-      pool_airdrop_rewards[sym]    = pool_airdrop_reward;
-      //内部调用发放利息
-      //发放利息
-      if(total_rewards.amount > 0) {
-         tyche_reward::claimreward_action claim_reward_act(_gstate.reward_contract, { {get_self(), "active"_n} });
-         claim_reward_act.send(from, reward_symbol_ptr->sym.get_contract(), total_rewards, "reward:" + to_string(term_code));
-         existed = true;
-      }
-      reward_symbol_ptr++;
-   }
-
-   auto pool_interest_reward     = pool_itr->interest_reward;
-   auto eraner_interest_reward   = acct->interest_reward;
-   {
-      auto total_rewards         = _update_reward_info(pool_interest_reward, eraner_interest_reward, acct->avl_principal, term_end_flag);
-      //内部调用发放利息
-      //发放利息
-      if(total_rewards.amount > 0) {
-         tyche_reward::claimintr_action cliam_interest_act(_gstate.reward_contract, { {get_self(), "active"_n} });
-         cliam_interest_act.send(from, MUSDT_BANK, total_rewards, "interest:" + to_string(term_code));
-         existed = true;
-      }
-   }
+         auto total_rewards = _update_reward_info(c.interest_reward, a.interest_reward, avl_principal, term_end_flag);
+         //汇总, 由 _pay_rewards 统一发放
+         if(total_rewards.amount > 0) {
+            interest += total_rewards;
+            existed = true;
+         }
+         //复投: 利息计入本金, 到期时间不变
+         if( compound && !term_end_flag ) {
+            compounded                 = total_rewards;
+            c.cum_principal            += compounded;
+            c.avl_principal            += compounded;
+         }
 
+         if( term_end_flag )
+            c.avl_principal.amount     -= avl_principal.amount;
+      });
 
-   pools.modify( pool_itr, _self, [&]( auto& c ) {
-      c.interest_reward                = pool_interest_reward;
       if( term_end_flag )
-         c.avl_principal.amount        -= acct->avl_principal.amount;
-      c.airdrop_rewards                = pool_airdrop_rewards;
-   });
-
-   accts.modify( acct, _self, [&]( auto& a ) {
-      a.interest_reward                = eraner_interest_reward;
-      if( term_end_flag ) {
          a.avl_principal.amount        = 0;
-      }
-
-      a.airdrop_rewards                = earner_airdrop_rewards;
+      a.cum_principal                  += compounded;
+      a.avl_principal                  += compounded;
+      //赎回时本金已由 onredeem 扣减
+      if( !term_end_flag )
+         _move_maturity( a, a.term_ended_at, avl_principal.amount );
    });
    return existed;
 }
 
-bool tyche_earn::_claim_pool_rewards_by_symbol(const name& from, const uint64_t& term_code, const symbol& reward_symbol, const bool& term_end_flag ){
-   auto reward_symbols     = reward_symbol_t::idx_t(_self, _self.value);
+bool tyche_earn::_claim_pool_rewards_by_symbol(const name& from, const uint64_t& term_code, const symbol& reward_symbol, const bool& term_end_flag,
+                                               reward_payouts& rewards, asset& interest, const bool& compound ){
+   auto& reward_symbols    = _db.cache<reward_symbol_t>(_self.value);
    bool existed            = false;
 
-   auto now                = time_point_sec(current_time_point());
-   auto pools              = earn_pool_t::tbl_t(_self, _self.value);
-   auto pool_itr           = pools.find( term_code );
-   CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
+   auto& pools             = _db.cache<earn_pool_t>(_self.value);
+   CHECKC( pools.find( term_code ) != nullptr, err::RECORD_NOT_FOUND, "earn pool not found" )
 
-   auto accts  = earner_t::tbl_t(_self, term_code);
+   auto& accts = _db.cache<earner_t>(term_code);
    auto acct   = accts.find( from.value );
-   if(acct == accts.end())
+   if(acct == nullptr)
       return false;
 
-   auto reward_symbol_ptr        = reward_symbols.find(reward_symbol.code().raw());
-   auto earner_airdrop_rewards   = acct->airdrop_rewards;
-   auto pool_airdrop_rewards     = pool_itr->airdrop_rewards;
-   if(reward_symbol_ptr != reward_symbols.end() && reward_symbol_ptr->on_shelf && pool_itr->airdrop_rewards.count( reward_symbol ) != 0) {
-      earner_reward_st earner_airdrop_reward = {0, asset(0, reward_symbol), asset(0,reward_symbol), asset(0, reward_symbol)};
-      if(acct->airdrop_rewards.count( reward_symbol ) > 0) {
-         earner_airdrop_reward   = acct->airdrop_rewards.at(reward_symbol);
-      }
-      auto pool_airdrop_reward     = pool_itr->airdrop_rewards.at(reward_symbol);
-
-
-      auto total_rewards                     = _update_reward_info(pool_airdrop_reward, earner_airdrop_reward, acct->avl_principal, term_end_flag);
-      earner_airdrop_rewards[reward_symbol]  = earner_airdrop_reward;
-      pool_airdrop_rewards[reward_symbol]    = pool_airdrop_reward;
-      //内部调用发放利息
-      //发放利息
-      if(total_rewards.amount > 0) {
-         tyche_reward::claimreward_action claim_reward_act(_gstate.reward_contract, { {get_self(), "active"_n} });
-         claim_reward_act.send(from, reward_symbol_ptr->sym.get_contract(), total_rewards, "reward:" + to_string(term_code));
-         existed = true;
-      }
-      reward_symbol_ptr++;
-   }
+   auto avl_principal = acct->avl_principal;
+   auto compounded    = asset(0, avl_principal.symbol);
+   accts.modify( from.value, [&]( auto& a ) {
+      pools.modify( term_code, [&]( auto& c ) {
+         auto pool_reward_itr = c.airdrop_rewards.find( reward_symbol );
+         if( pool_reward_itr != c.airdrop_rewards.end() ) {
+            auto reward_symbol_ptr = reward_symbols.find( reward_symbol.code().raw() );
+            if( reward_symbol_ptr != nullptr && reward_symbol_ptr->on_shelf ) {
+               auto& earner_airdrop_reward = _get_earner_reward(a.airdrop_rewards, reward_symbol);
+               auto total_rewards          = _update_reward_info(pool_reward_itr->second, earner_airdrop_reward, avl_principal, term_end_flag);
+               //汇总, 由 _pay_rewards 统一发放
+               if(total_rewards.amount > 0) {
+                  auto payout = rewards.try_emplace(reward_symbol_ptr->sym, 0, total_rewards.symbol).first;
+                  payout->second += total_rewards;
+                  existed = true;
+               }
+            }
+         }
 
-   auto pool_interest_reward     = pool_itr->interest_reward;
-   auto eraner_interest_reward   = acct->interest_reward;
+         if(reward_symbol == MUSDT) {
+            auto total_rewards = _update_reward_info(c.interest_reward, a.interest_reward, avl_principal, term_end_flag);
+            //汇总, 由 _pay_rewards 统一发放
+            if(total_rewards.amount > 0) {
+               interest += total_rewards;
+               existed = true;
+            }
+            //复投: 同 _claim_pool_rewards
+            if( compound && !term_end_flag ) {
+               compounded              = total_rewards;
+               c.cum_principal         += compounded;
+               c.avl_principal         += compounded;
+            }
+         }
+      });
 
-   if(reward_symbol == MUSDT) {
-      auto total_rewards         = _update_reward_info(pool_interest_reward, eraner_interest_reward, acct->avl_principal, term_end_flag);
-      //内部调用发放利息
-      //发放利息
-      if(total_rewards.amount > 0) {
-         tyche_reward::claimintr_action cliam_interest_act(_gstate.reward_contract, { {get_self(), "active"_n} });
-         cliam_interest_act.send(from, MUSDT_BANK, total_rewards, "interest:" + to_string(term_code));
-         existed = true;
+      if( compounded.amount > 0 ) {
+         a.cum_principal               += compounded;
+         a.avl_principal               += compounded;
+         _move_maturity( a, a.term_ended_at, avl_principal.amount );
       }
-   }
-
-   pools.modify( pool_itr, _self, [&]( auto& c ) {
-      c.interest_reward                = pool_interest_reward;
-      c.airdrop_rewards                = pool_airdrop_rewards;
-   });
-
-   accts.modify( acct, _self, [&]( auto& a ) {
-      a.interest_reward                = eraner_interest_reward;
-      a.airdrop_rewards                = earner_airdrop_rewards;
    });
    return existed;
 }
 
-
+earner_reward_st& tyche_earn::_get_earner_reward(earner_reward_map& rewards, const symbol& sym) {
+   auto itr = rewards.find( sym );
+   if( itr == rewards.end() )
+      itr = rewards.emplace( sym, earner_reward_st{0, asset(0, sym), asset(0, sym), asset(0, sym)} ).first;
+   return itr->second;
+}
 
 //领取奖励,返回要领取的奖励
 asset tyche_earn::_update_reward_info( earn_pool_reward_st& pool_reward, earner_reward_st& earner_reward, const asset& earner_avl_principal, const bool& term_end_flag) {
@@ -640,8 +1046,11 @@ void tyche_earn::updateexpiry(const uint64_t& code, const name& owner) {
    auto pools              = earn_pool_t::tbl_t(_self, _self.value);
    auto pool_itr           = pools.find( code );
    CHECKC( pool_itr != pools.end(), err::RECORD_NOT_FOUND, "earn pool not found" )
+   auto term_ended_at      = acct->term_started_at + pool_itr->term_interval_sec;
+   auto older_ended_at     = acct->term_ended_at;
    accts.modify( acct, _self, [&]( auto& a ) {
-      a.term_ended_at       =  a.term_started_at + pool_itr->term_interval_sec;
+      a.term_ended_at       =  term_ended_at;
+      _move_maturity( a, older_ended_at, a.avl_principal.amount );
    });
 }
 
@@ -651,6 +1060,7 @@ void tyche_earn::setpool(const uint64_t& code, const uint64_t& term_interval_sec
    auto pools              = earn_pool_t::tbl_t(_self, _self.value);
    auto pool_itr           = pools.find( code );
    if( pool_itr == pools.end() ) {
+      CHECKC( std::distance( pools.begin(), pools.end() ) < MAX_EARN_POOLS, err::OVERSIZED, "too many earn pools" )
       pools.emplace( _self, [&]( auto& c ) {
          c.code                  = code;
          c.term_interval_sec     = term_interval_sec;
@@ -673,6 +1083,10 @@ void tyche_earn::onshelfsym(const extended_symbol& sym, const bool& on_shelf) {
    auto reward_symbols     = reward_symbol_t::idx_t(_self, _self.value);
    auto reward_symbol      = reward_symbols.find( sym.get_symbol().code().raw() );
    CHECKC( reward_symbol != reward_symbols.end(), err::RECORD_NOT_FOUND, "reward symbol not found" )
+   if( on_shelf ) {
+      auto compacts        = reward_compact_t::tbl_t(_self, sym.get_symbol().code().raw());
+      CHECKC( compacts.begin() == compacts.end(), err::STATUS_ERROR, "reward compaction in progress" )
+   }
    reward_symbols.modify( reward_symbol, _self, [&]( auto& s ) {
       s.on_shelf               = on_shelf;
    });
@@ -707,9 +1121,73 @@ void tyche_earn::sendtoloan( const asset& quant ){
    require_auth( _self );
    CHECKC( quant.amount > 0, err::NOT_POSITIVE, "must transfer positive quantity:" + quant.to_string() );
    CHECKC( quant.symbol == _gstate.principal_token.get_symbol(), err::SYMBOL_MISMATCH, "invalid symbol" );
+   _send_to_loan( quant );
+}
+
+void tyche_earn::_send_to_loan( const asset& quant ){
    _gloan.loan_quant += quant;
    TRANSFER( _gstate.principal_token.get_contract(), _gloan.tyche_proxy_contract, quant, "tyche_loan add" );
 }
+
+void tyche_earn::setrebalconf(const rebalance_conf_t& conf) {
+   require_auth( _self );
+   CHECKC( is_account(conf.keeper), err::ACCOUNT_INVALID, "keeper not exists" )
+   CHECKC( is_account(conf.loan_contract), err::ACCOUNT_INVALID, "loan contract not exists" )
+   CHECKC( conf.horizon_days > 0, err::PARAM_ERROR, "horizon_days must be positive" )
+   CHECKC( conf.loan_min_idle_ratio <= conf.loan_max_idle_ratio, err::PARAM_ERROR, "loan idle band invalid" )
+   CHECKC( conf.min_transfer_quant.symbol == _gstate.principal_token.get_symbol(), err::SYMBOL_MISMATCH, "invalid symbol" )
+   auto confs              = rebalance_conf_singleton(_self, _self.value);
+   confs.set( conf, _self );
+}
+
+/**
+ * earn 侧: 可用余额需覆盖未来 horizon_days 天内到期的本金(含缓冲)
+ * loan 侧: 可用本金应处于已借出本金的 [min, max] 区间
+ * 赎回需求优先; 每次只按一个方向调拨一笔, 区间内不调拨
+ * 从 loan 调回需要 loan 账户的 loan_permission 权限包含 earn@eosio.code 且关联 sendtoearn
+ */
+void tyche_earn::rebalance(const name& keeper) {
+   require_auth( keeper );
+   auto confs              = rebalance_conf_singleton(_self, _self.value);
+   CHECKC( confs.exists(), err::RECORD_NOT_FOUND, "rebalance conf not found" )
+   auto conf               = confs.get();
+   CHECKC( keeper == conf.keeper || keeper == _gstate.admin, err::NO_AUTH, "no auth to rebalance" )
+
+   auto loan_globals       = loan_global_singleton(conf.loan_contract, conf.loan_contract.value);
+   CHECKC( loan_globals.exists(), err::RECORD_NOT_FOUND, "loan global not found" )
+   auto loan_gstate        = loan_globals.get();
+   auto sym                = _gstate.principal_token.get_symbol();
+   CHECKC( loan_gstate.avl_principal_quant.symbol == sym, err::SYMBOL_MISMATCH, "loan symbol mismatch" )
+
+   int64_t earn_idle       = flon::token::get_balance( _gstate.principal_token.get_contract(), _self, sym.code() ).amount;
+   int64_t earn_need       = _get_maturing_principal( conf.horizon_days );
+   int64_t earn_target     = (int128_t)earn_need * (PCT_BOOST + conf.earn_buffer_ratio) / PCT_BOOST;
+
+   int64_t loan_idle       = loan_gstate.avl_principal_quant.amount;
+   int64_t loan_lent       = loan_gstate.total_principal_quant.amount - loan_idle;
+   int64_t loan_lower      = (int128_t)loan_lent * conf.loan_min_idle_ratio / PCT_BOOST;
+   int64_t loan_upper      = (int128_t)loan_lent * conf.loan_max_idle_ratio / PCT_BOOST;
+   int64_t loan_target     = (loan_lower + loan_upper) / 2;
+
+   int64_t pull            = 0;     //loan -> earn
+   int64_t push            = 0;     //earn -> loan
+   if( earn_idle < earn_need ) {
+      pull                 = std::min( earn_target - earn_idle, loan_idle );
+   } else if( loan_idle < loan_lower ) {
+      push                 = std::min( earn_idle - earn_target, loan_target - loan_idle );
+   } else if( loan_idle > loan_upper && earn_idle < earn_target ) {
+      pull                 = std::min( loan_idle - loan_target, earn_target - earn_idle );
+   }
+   //调回金额不能超过已调出的本金, 否则 proxy 转回时 ontransfer 会失败
+   pull                    = std::min( pull, _gloan.loan_quant.amount );
+
+   if( push > 0 && push >= conf.min_transfer_quant.amount ) {
+      _send_to_loan( asset(push, sym) );
+   } else if( pull > 0 && pull >= conf.min_transfer_quant.amount ) {
+      tyche_loan::sendtoearn_action act{ conf.loan_contract, { {conf.loan_contract, conf.loan_permission} } };
+      act.send( asset(pull, sym) );
+   }
+}
 void tyche_earn::initloaninfo(const name& tyche_proxy_contract ){
    require_auth( _self );
    _gloan.tyche_proxy_contract   = tyche_proxy_contract;
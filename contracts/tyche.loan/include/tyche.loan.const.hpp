@@ -10,6 +10,6 @@ static constexpr uint16_t  PCT_BOOST         = 10000;
 static constexpr uint64_t  DAY_SECONDS       = 24 * 60 * 60;
 static constexpr uint64_t  YEAR_SECONDS      = 24 * 60 * 60 *365;
 static constexpr uint64_t  YEAR_DAYS         = 365;
-static constexpr int128_t  HIGH_PRECISION    = 1'000'000'000'000'000'000; // 10^18
 static constexpr int64_t   RATIO_PRECISION   = 100000;       // 10^5, the ratio precision
+static constexpr uint32_t  INTEREST_HISTORY_BUDGET = 32;     //单次按 interests 历史计息最多遍历的利率区间数
 
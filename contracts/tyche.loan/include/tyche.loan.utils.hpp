@@ -4,7 +4,7 @@
 #include <algorithm>
 #include <iterator>
 #include <eosio/eosio.hpp>
-#include "safe.hpp"
+#include <tyche.common/safe.hpp>
 
 #include <eosio/asset.hpp>
 #include<tyche.loan.const.hpp>
@@ -14,7 +14,7 @@ using namespace std;
 
 inline int64_t calc_coin_amount( const asset &base_quant, const asset &price ) {
     int128_t precision = calc_precision( base_quant.symbol.precision() );
-    return mul64( base_quant.amount, price.amount, precision );
+    return multiply_decimal64( base_quant.amount, price.amount, precision );
 }
 
 inline asset calc_quote_quant(const asset &base_quant, const asset &price) {
@@ -22,7 +22,7 @@ inline asset calc_quote_quant(const asset &base_quant, const asset &price) {
 }
 
 inline asset calc_quant( const asset &quant, const uint64_t& ratio ) {
-    return asset( mul64(quant.amount, ratio, PCT_BOOST), quant.symbol);
+    return asset( multiply_decimal64(quant.amount, ratio, PCT_BOOST), quant.symbol);
 }
 inline int64_t calc_asset_amount(const asset &quote_quant, const asset &price, const symbol &base_symbol) {
     ASSERT(quote_quant.symbol.precision() == price.symbol.precision());
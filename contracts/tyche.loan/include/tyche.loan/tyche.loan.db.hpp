@@ -1,12 +1,14 @@
 #pragma once
 
 #include <eosio/asset.hpp>
+#include <eosio/binary_extension.hpp>
 #include <eosio/privileged.hpp>
 #include <eosio/singleton.hpp>
 #include <eosio/system.hpp>
 #include <eosio/time.hpp>
 
-#include <utils.hpp>
+#include <tyche.common/utils.hpp>
+#include <tyche.common/row_version.hpp>
 
 // #include <deque>
 #include <optional>
@@ -35,16 +37,23 @@ static constexpr symbol     TYCHE            = symbol(symbol_code("TYCHE"), 8);
 
 const static string     DEPOSIT                         = "deposit";            //用户发起
 const static string     TYPE_SEND_BACK                  = "sendback";           //归还
-const static string     TYPE_SEND_BACK_INTERNAL_LIQ     = "sendbacki_liq";      //归还
-const static string     TYPE_SEND_BACK_INTERNAL_CLOSE   = "sendbacki_close";    //归还
-const static string     TYPE_FORCECLOSE_INTRENAL        = "forceclosei";        //强平
 const static string     TYPE_REDEEM                     = "redeem";             //赎回
-const static string     TYPE_LIQUIDATE_INTERNAL         = "liquidatei";         //清算
 const static string     TYPE_LEND                       = "lend";               //借出
 const static string     TYPE_GIVE_CHANGE                = "givechange";         //找零
 const static string     TYPE_GIVE_CHANGE_LIQ            = "givechange_liq";     //找零
 const static string     TYPE_GIVE_CHANGE_CLOSE          = "givechange_close";   //找零
 const static string     TYPE_BUY                        = "liqbuy";             //归还清算人的U
+const static string     TYPE_BUY_BATCH                  = "liqbuys";            //批量清算: liqbuys:<sym>:<acct1>,<acct2>,...
+
+//清算事件中的内部转账类型
+static constexpr name       LEG_SEND_BACK_LIQ           = "sendbackliq"_n;          //清算: 清算人 MUSDT 归还本金
+static constexpr name       LEG_LIQUIDATE               = "liquidatei"_n;           //清算: 抵押物转给清算人
+static constexpr name       LEG_FORCECLOSE              = "forceclosei"_n;          //强平: 抵押物归平台
+static constexpr name       LEG_SEND_BACK_CLOSE         = "sendbackcls"_n;          //强平: 本金由平台承接
+
+static constexpr uint64_t   RECENT_LIQ_CAPACITY         = 256;                      //最近清算记录环形表容量
+static constexpr uint64_t   MAX_LIQ_BATCH_SIZE          = 50;                       //批量清算/强平单次最多账户数
+static constexpr uint64_t   DEFAULT_MAX_PRICE_AGE_SEC   = 60 * 60;                  //预言机价格默认有效期
 
 #define HASH256(str) sha256(const_cast<char*>(str.c_str()), str.size())
 
@@ -70,13 +79,14 @@ NTBL("global") global_t {
     asset               total_interest_quant;                          //总利息
 
     bool                enabled                 = true;
+    binary_extension<uint64_t> max_price_age_sec;                      //价格最长有效秒数, 0 不检查, 无值取 DEFAULT_MAX_PRICE_AGE_SEC
 
     EOSLIB_SERIALIZE( global_t, (admin)(lp_refueler)(price_oracle_contract)
                                 (loan_token)(min_deposit_amount)(term_interval_days)
                                 (liquidation_penalty_ratio)(liquidation_price_ratio)
                                 (total_principal_quant)(avl_principal_quant)
                                 (tyche_proxy_contract)(total_interest_quant)
-                                (enabled) )
+                                (enabled)(max_price_age_sec) )
 };
 typedef eosio::singleton< "global"_n, global_t > global_singleton;
 
@@ -91,6 +101,16 @@ TBL interest_t {
     EOSLIB_SERIALIZE( interest_t, (begin_at)(ended_at)(interest_ratio) )
 };
 
+//累计利率指数: 每单位本金至 updated_at 的累计利息(wad 定点), addinterest 时结转
+NTBL("interestidx") interest_index_t {
+    int128_t            cum_index           = 0;
+    uint64_t            interest_ratio      = 0;            //当前年化利率
+    time_point_sec      updated_at;
+
+    EOSLIB_SERIALIZE( interest_index_t, (cum_index)(interest_ratio)(updated_at) )
+};
+typedef eosio::singleton< "interestidx"_n, interest_index_t > interest_index_singleton;
+
 
 //Scope: symbol
 //Note: record will be deleted upon withdrawal/redemption
@@ -108,17 +128,66 @@ TBL loaner_t {
     asset               paid_interest;                  //已支付利息
 
     time_point_sec      created_at;
+    binary_extension<int128_t> settled_index;           //term_settled_at 时的累计利率指数, 无值时按 interests 历史计算
+    binary_extension<uint8_t>  row_version;             //存储时的行版本, 写入时总是 ROW_VERSION; 无 settled_index 的旧行结算前保持 v0
+
+    static constexpr uint8_t ROW_VERSION = 1;
 
     loaner_t() {}
     loaner_t(const name& a): owner(a) {}
 
     uint64_t primary_key()const { return owner.value; }
 
+    //v1: 仅增加 row_version
+    void upgrade_from( const uint8_t& ) {}
+
     typedef multi_index<"loaners"_n, loaner_t> tbl_t;
 
-    EOSLIB_SERIALIZE( loaner_t, (owner)(cum_collateral_quant)(avl_collateral_quant)(avl_principal)
+    TYCHE_ROW_SERIALIZE( loaner_t, (owner)(cum_collateral_quant)(avl_collateral_quant)(avl_principal)
                                 (term_started_at)(term_settled_at)(term_ended_at)
-                                (unpaid_interest)(paid_interest)(created_at) )
+                                (unpaid_interest)(paid_interest)(created_at)(settled_index)(row_version) )
+};
+
+//Scope: symbol, 同 loaners
+//抵押率触及清算线/强平线时的抵押物价格(loan_token 精度), 当前价格 <= 触发价即可清算
+//欠款(本金 + 已结算利息)为 0 时删除
+TBL loan_trigger_t {
+    name                owner;                          //PK
+    uint64_t            liq_price           = 0;        //抵押率 = liquidation_ratio 时的价格
+    uint64_t            force_price         = 0;        //抵押率 = force_liquidate_ratio 时的价格
+
+    loan_trigger_t() {}
+    loan_trigger_t(const name& a): owner(a) {}
+
+    uint64_t primary_key()const { return owner.value; }
+    uint64_t by_liq_price()const { return liq_price; }
+    uint64_t by_force_price()const { return force_price; }
+
+    typedef multi_index<"triggers"_n, loan_trigger_t,
+        indexed_by<"byliqprice"_n,   const_mem_fun<loan_trigger_t, uint64_t, &loan_trigger_t::by_liq_price>>,
+        indexed_by<"byforceprice"_n, const_mem_fun<loan_trigger_t, uint64_t, &loan_trigger_t::by_force_price>>
+    > tbl_t;
+
+    EOSLIB_SERIALIZE( loan_trigger_t, (owner)(liq_price)(force_price) )
+};
+
+//Scope: _self
+//setsymratio 修改抵押率后该币种的触发价待重建, updtriggers 从 next_owner 续做, 全部重建后删除
+//存在时该币种 triggers 中尚未处理的行仍按旧抵押率计算
+TBL trigger_cursor_t {
+    symbol              sym;                            //PK, 抵押物币种
+    name                next_owner;                     //下一批从此 owner 开始
+    uint64_t            processed           = 0;        //已重建的用户数
+    time_point_sec      updated_at;
+
+    trigger_cursor_t() {}
+    trigger_cursor_t(const symbol& s): sym(s) {}
+
+    uint64_t primary_key()const { return sym.code().raw(); }
+
+    typedef multi_index<"trgcursor"_n, trigger_cursor_t> tbl_t;
+
+    EOSLIB_SERIALIZE( trigger_cursor_t, (sym)(next_owner)(processed)(updated_at) )
 };
 
 //Scope: _self
@@ -241,4 +310,50 @@ struct global_state: public globalidx {
         uint64_t primary_key() const    { return id; }
  };
 
+//Scope: _self
+//最近 RECENT_LIQ_CAPACITY 条清算记录, slot = liqlog.id % RECENT_LIQ_CAPACITY, 新记录原地覆盖旧记录
+TBL recent_liq_t {
+    uint64_t            slot;                           //PK
+    liqlog_t            liqlog;
+
+    recent_liq_t() {}
+    recent_liq_t(const uint64_t& s): slot(s) {}
+
+    uint64_t primary_key()const { return slot; }
+
+    typedef multi_index<"recentliqs"_n, recent_liq_t> tbl_t;
+
+    EOSLIB_SERIALIZE( recent_liq_t, (slot)(liqlog) )
+};
+
+//Scope: _self
+//按抵押币种累计的清算统计
+TBL liq_stat_t {
+    symbol              sym;                            //PK, 抵押物币种
+    uint64_t            liq_count           = 0;        //清算次数
+    uint64_t            force_count         = 0;        //强平次数
+    asset               liq_collateral_quant;           //清算卖出的抵押物
+    asset               force_collateral_quant;         //强平没收的抵押物
+    uint64_t            last_liqlog_id      = 0;
+    time_point          last_liq_at;
+
+    liq_stat_t() {}
+    liq_stat_t(const symbol& s): sym(s) {}
+
+    uint64_t primary_key()const { return sym.code().raw(); }
+
+    typedef multi_index<"liqstats"_n, liq_stat_t> tbl_t;
+
+    EOSLIB_SERIALIZE( liq_stat_t, (sym)(liq_count)(force_count)(liq_collateral_quant)(force_collateral_quant)
+                                  (last_liqlog_id)(last_liq_at) )
+};
+
+ //清算时的一笔内部转账, 仅记录在清算事件中
+ struct liqleg_t {
+        name        type;                   //LEG_*
+        name        from;
+        name        to;
+        asset       quant;
+ };
+
 } //namespace tychefi
\ No newline at end of file
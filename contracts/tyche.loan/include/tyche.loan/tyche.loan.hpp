@@ -5,10 +5,14 @@
 #include <eosio/permission.hpp>
 #include <eosio/action.hpp>
 
+#include <optional>
+#include <set>
 #include <string>
 
 #include <tyche.loan/tyche.loan.db.hpp>
-#include <wasm_db.hpp>
+#include <tyche.common/wasm_db.hpp>
+#include <tyche.common/state_snapshot.hpp>
+#include <tyche.common/bounded_work.hpp>
 namespace tychefi {
 
 using std::string;
@@ -61,12 +65,15 @@ class [[eosio::contract("tyche.loan")]] tyche_loan : public contract {
 
    tyche_loan(eosio::name receiver, eosio::name code, datastream<const char*> ds): contract(receiver, code, ds),
         _global(get_self(), get_self().value), _db(_self),
+        _interest_index_tbl(get_self(), get_self().value),
         _global_state(global_state::make_global(get_self()))
     {
-      _gstate = _global.exists() ? _global.get() : global_t{};
+      _gstate = load_state<global_singleton, global_t>( _global, _gstate_snapshot );
     }
 
-    ~tyche_loan() { _global.set( _gstate, get_self() );
+    ~tyche_loan() {
+      //未变化的全局表不回写
+      save_state( _global, _gstate, _gstate_snapshot, get_self() );
       _global_state->save(get_self());
    }
 
@@ -78,6 +85,8 @@ class [[eosio::contract("tyche.loan")]] tyche_loan : public contract {
    ACTION getmoreusdt( const name& from, const symbol& callat_sym, const asset& quant );
 
    ACTION forceliq( const name& from, const name& liquidator, const symbol& callat_sym );
+   //批量强平同一抵押币种下的多个账户, 不满足强平条件的账户跳过
+   ACTION forceliqs( const name& from, const symbol& callat_sym, const std::vector<name>& liquidators );
 
    //admin
    ACTION init(const name& admin, const name& lp_refueler,
@@ -87,11 +96,21 @@ class [[eosio::contract("tyche.loan")]] tyche_loan : public contract {
    ACTION initoracle(const name& price_oracle_contract);
    ACTION addinterest(const uint64_t& interest_ratio);
    ACTION setliqpratio(const uint64_t& liquidation_price_ratio);
+   ACTION setpriceage(const uint64_t& max_price_age_sec);
    ACTION setcallatsym( const extended_symbol& sym, const name& oracle_sym_name );
    ACTION setsymratio(const symbol& sym, const uint64_t& init_ratio, const uint64_t liq_ratio,  const uint64_t force_ratio);
    ACTION setcollquant(const symbol& sym, const asset& min_collateral_quant, const asset& max_collateral_quant);
    ACTION setcollavl(const symbol& sym, const asset& avl_principal);
    ACTION setavlprncpl(const asset& quant);
+   //重算触发价: 修改抵押率配置后, 从 start 开始最多处理 max_rows 个用户
+   //start 为空时从 trigger_cursor_t 记录的位置续做, 处理到最后一个用户时删除该记录
+   ACTION updtriggers(const symbol& callat_sym, const name& start, const uint32_t& max_rows);
+   //从 start 开始最多检查 max_rows 个用户, 旧版本行写回为最新版本; 返回下一批的 start, 处理完返回空
+   [[eosio::action]]
+   name migraterows(const symbol& callat_sym, const name& start, const uint32_t& max_rows);
+   //未建立 settled_index 的用户按时间顺序结算最多 INTEREST_HISTORY_BUDGET 个利率区间, 重复调用直至结算到当前
+   //起点所在区间按实际时长计息, 旧的逐区间扫描跨区间时不计该区间
+   ACTION settlehist(const symbol& callat_sym, const name& owner);
 
    //admin
    // ACTION tgetprice( const symbol& collateral_sym );
@@ -100,15 +119,19 @@ class [[eosio::contract("tyche.loan")]] tyche_loan : public contract {
 
    ACTION sendtoearn( const asset& quant );
 
-   ACTION notifyliq( const liqlog_t& liqlog );
-   using notifyliq_action   = action_wrapper<"notifyliq"_n,  &tyche_loan::notifyliq>;
-   ACTION notifytran(const name& from, const name& to, const asset& quants, const string& memo);
-   using notifytranfer_action   = action_wrapper<"notifytran"_n,  &tyche_loan::notifytran>;
+   //清算事件: 清算记录 + 内部转账明细, 每次清算/强平一条
+   ACTION liqevent( const liqlog_t& liqlog, const std::vector<liqleg_t>& legs );
+   using liqevent_action    = action_wrapper<"liqevent"_n,  &tyche_loan::liqevent>;
+   //批量清算事件: legs 按 from 与 liqlog.liquidator 对应
+   ACTION liqbatch( const std::vector<liqlog_t>& liqlogs, const std::vector<liqleg_t>& legs );
+   using liqbatch_action    = action_wrapper<"liqbatch"_n,  &tyche_loan::liqbatch>;
 
    private:
 
       //清算
       void _liquidate( const name& from, const name& liquidator, const symbol& callat_sym, const asset& quant );
+      //批量清算/强平: 价格只读一次, collsyms/手续费/利息汇总后各写一次, 剩余 MUSDT 一次退回
+      void _liquidate_batch( const name& from, const symbol& callat_sym, const std::vector<name>& liquidators, const asset& quant );
 
       asset calc_collateral_quant( const asset& collateral_quant, const asset& paid_principal_quant, const name& oracle_sym_name, asset& settle_price);
 
@@ -118,16 +141,29 @@ class [[eosio::contract("tyche.loan")]] tyche_loan : public contract {
 
       uint64_t get_callation_ratio(const asset& collateral_quant, const asset& principal, const name& oracle_sym_name);
 
+      //读取预言机该币种 scope 下最新价格, 按 loan_token 精度返回
       uint64_t get_index_price( const name& base_code );
 
       void _add_fee(const asset& quantity);
 
+      //写入最近清算环形表并累计该抵押币种的清算统计, liqlogs 须为同一抵押币种
+      void _record_liqs( const std::vector<liqlog_t>& liqlogs );
+
+      //抵押物/本金/结算变化后更新用户的清算触发价
+      void _update_trigger( const collateral_symbol_t& coll, const loaner_t& loaner );
+
       asset _sub_fee(const symbol& sym);
 
       uint64_t _get_current_interest_ratio();
       asset _get_dynamic_interest( const asset& quant, const time_point_sec& time_start, const time_point_sec& time_end);
-
-      const price_global_t& _price_conf();
+      //建立累计利率指数: init/addinterest/migraterows 调用, 已存在时不变
+      void _init_interest_index();
+      //当前累计利率指数, 只读; 尚未建立时返回空, 用户按 interests 历史结算
+      std::optional<int128_t> _get_interest_index();
+      //记录结算点的累计指数, 尚未建立指数时保持按历史结算
+      void _set_settled_index( loaner_t& loaner );
+      //用户自上次结算以来的利息
+      asset _get_accrued_interest( const loaner_t& loaner );
 
       asset _get_interest( const asset& principal, const uint64_t& interest_ratio, const time_point_sec& started_at, const time_point_sec& term_settled_at );
 
@@ -139,11 +175,13 @@ class [[eosio::contract("tyche.loan")]] tyche_loan : public contract {
 
       global_singleton     _global;
       global_t             _gstate;
+      state_snapshot       _gstate_snapshot;
       dbc                  _db;
+      interest_index_singleton _interest_index_tbl;   //读写同一实例, 避免重复加载
       global_state::ptr_t   _global_state;
 
-      std::unique_ptr<price_global_t::idx_t>    _global_prices_tbl_ptr;
-      std::unique_ptr<price_global_t>     _global_prices_ptr;
+      std::map<name, uint64_t>            _index_prices;        //本次 action 已读取的价格
+      std::unique_ptr<interest_index_t>   _interest_index_ptr;
 
 };
 } //namespace tychefi
@@ -7,7 +7,7 @@
 
 #include <string>
 
-#include <wasm_db.hpp>
+#include <tyche.common/wasm_db.hpp>
 
 namespace tychefi {
 
@@ -20,7 +20,12 @@ class tyche_reward {
       [[eosio::action]]
       void claimintr( const name& to, const name& bank, const asset& total_interest, const string& memo);
 
+      //批量领取奖励, 每个(bank, symbol)一条
+      [[eosio::action]]
+      void claimrewards( const name& to, const std::vector<extended_asset>& rewards, const string& memo );
+
       using claimreward_action   = eosio::action_wrapper<"claimreward"_n,  &tyche_reward::claimreward>;
       using claimintr_action     = eosio::action_wrapper<"claimintr"_n,    &tyche_reward::claimintr>;
+      using claimrewards_action  = eosio::action_wrapper<"claimrewards"_n, &tyche_reward::claimrewards>;
 };
 } //namespace tychefi
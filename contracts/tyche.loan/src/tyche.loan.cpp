@@ -1,9 +1,10 @@
 #include <tyche.loan/tyche.loan.hpp>
 #include <tyche.reward/tyche.reward.hpp>
-#include <flon.token.hpp>
+#include <tyche.common/flon.token.hpp>
 
-#include "safemath.hpp"
-#include <utils.hpp>
+#include <tyche.common/safemath.hpp>
+#include <tyche.common/utils.hpp>
+#include <tyche.common/memo.hpp>
 // #include <eosiolib/time.hpp>
 #include <eosio/time.hpp>
 #include<tyche.reward/tyche.reward.db.hpp>
@@ -15,13 +16,13 @@ namespace tychefi {
 using namespace std;
 using namespace wasm::safemath;
 
-#define NOTIFY_LIQ_ACTION( item) \
-     { tyche_loan::notifyliq_action act{ _self, { {_self, active_perm} } };\
-	        act.send( item );}
+#define NOTIFY_LIQ_EVENT( item, legs ) \
+     { tyche_loan::liqevent_action act{ _self, { {_self, active_perm} } };\
+	        act.send( item, legs );}
 
-#define NOTIFY_TRANSFER_ACTION( from, to, quants, memo) \
-     { tyche_loan::notifytranfer_action act{ _self, { {_self, active_perm} } };\
-	        act.send( from, to, quants, memo );}
+#define NOTIFY_LIQ_BATCH( items, legs ) \
+     { tyche_loan::liqbatch_action act{ _self, { {_self, active_perm} } };\
+	        act.send( items, legs );}
 
 #define CHECKC(exp, code, msg) \
    { if (!(exp)) eosio::check(false, string("[[") + to_string((int)code) + string("]] ") + msg); }
@@ -36,19 +37,27 @@ inline int64_t get_precision(const asset &a) {
    return get_precision(a.symbol);
 }
 
+//抵押率 = collateral * price / 10^precision * PCT_BOOST / debt, 求抵押率等于 ratio 时的价格
+inline static uint64_t calc_trigger_price( const asset& collateral_quant, const asset& debt, const uint64_t& ratio ) {
+   if( collateral_quant.amount <= 0 ) return std::numeric_limits<uint64_t>::max();
+   int128_t price = mul_div( (int128_t)debt.amount * ratio, calc_precision(collateral_quant.symbol.precision()),
+                             (int128_t)PCT_BOOST * collateral_quant.amount );
+   return price > std::numeric_limits<uint64_t>::max() ? std::numeric_limits<uint64_t>::max() : (uint64_t)price;
+}
+
 //根据新打入rewards来计算新的reward_per_share
 inline static int128_t calc_reward_per_share_delta( const asset& rewards, const asset& total_shares) {
    ASSERT(rewards.amount >= 0 && total_shares.amount >= 0);
    int128_t new_reward_per_share_delta = 0;
    if (rewards.amount > 0 && total_shares.amount > 0) {
-      new_reward_per_share_delta = rewards.amount * HIGH_PRECISION / total_shares.amount;
+      new_reward_per_share_delta = wad::from_ratio( rewards.amount, total_shares.amount ).raw;
    }
    return new_reward_per_share_delta;
 }
 // 根据用户的votes和reward_per_share_delta来计算用户的rewards
 inline static asset calc_sharer_rewards(const asset& loaner_shares, const int128_t& reward_per_share_delta, const symbol& rewards_symbol) {
    ASSERT( loaner_shares.amount >= 0 && reward_per_share_delta >= 0 );
-   int128_t rewards = loaner_shares.amount * reward_per_share_delta / HIGH_PRECISION;
+   int128_t rewards = wad::from_raw( reward_per_share_delta ).times( loaner_shares.amount );
    // rewards = rewards * get_precision(rewards_symbol)/get_precision(loaner_shares.symbol);
    CHECK( rewards >= 0 && rewards <= std::numeric_limits<int64_t>::max(), "calculated rewards overflow" );
    return asset( (int64_t)rewards, rewards_symbol );
@@ -67,6 +76,7 @@ void tyche_loan::init(const name& admin, const name& lp_refueler,
    _gstate.avl_principal_quant      = asset(0, _gstate.loan_token.get_symbol());
    _gstate.total_interest_quant     = asset(0, _gstate.loan_token.get_symbol());
    _gstate.tyche_proxy_contract     =tyche_proxy_contract;
+   _init_interest_index();
 }
 
 void tyche_loan::initoracle(const name& price_oracle_contract) {
@@ -102,15 +112,25 @@ void tyche_loan::ontransfer(const name& from, const name& to, const asset& quant
          _gstate.avl_principal_quant   += quant;
          return;
       }
-      auto parts  = split( memo, ":" );
-      if (parts[0] == TYPE_SEND_BACK ) {
-         CHECKC( parts.size() == 2, err::PARAMETER_INVALID, "memo format error" );
-         auto sym = symbol_from_string(parts[1]);
+      memo_reader parts(memo, ':', (uint8_t)err::PARAMETER_INVALID);
+      auto type   = parts.next();
+      if( type == TYPE_SEND_BACK ) {
+         auto sym = parts.next_symbol();
+         parts.end();
          _on_pay_musdt(from, sym, quant);
-      } else if( parts[0] == TYPE_BUY ) {
-         CHECKC( parts.size() == 3, err::PARAMETER_INVALID, "memo format error" );
-         auto sym = symbol_from_string(parts[1]);
-         _liquidate(from, name(parts[2]), sym, quant);
+      } else if( type == TYPE_BUY ) {
+         auto sym = parts.next_symbol();
+         auto liquidator = parts.next_name();
+         parts.end();
+         _liquidate(from, liquidator, sym, quant);
+      } else if( type == TYPE_BUY_BATCH ) {
+         auto sym = parts.next_symbol();
+         memo_reader accounts(parts.next(), ',', (uint8_t)err::PARAMETER_INVALID);
+         parts.end();
+         std::vector<name> liquidators;
+         while( !accounts.done() )
+            liquidators.push_back( accounts.next_name() );
+         _liquidate_batch(from, sym, liquidators, quant);
       } else {
          CHECKC( false, err::PARAMETER_INVALID, "memo format error" );
       }
@@ -143,7 +163,7 @@ void tyche_loan::_on_pay_musdt( const name& from, const symbol& collateral_sym,
    CHECKC(collateral_itr != syms.end(), err::SYMBOL_MISMATCH, "symbol not supported");
 
    //结算利息
-   auto total_unpaid_interest = _get_dynamic_interest(itr->avl_principal, itr->term_settled_at, eosio::current_time_point());
+   auto total_unpaid_interest = _get_accrued_interest(*itr);
 
    total_unpaid_interest      += itr->unpaid_interest;
    CHECKC(total_unpaid_interest<= quant, err::OVERSIZED, "must pay more than interest")
@@ -167,8 +187,10 @@ void tyche_loan::_on_pay_musdt( const name& from, const symbol& collateral_sym,
       row.paid_interest          += total_unpaid_interest;
       row.unpaid_interest        = asset(0, total_unpaid_interest.symbol);
       row.term_settled_at        = eosio::current_time_point();
+      _set_settled_index(row);
       row.term_ended_at          = eosio::current_time_point() + eosio::days(_gstate.term_interval_days);
    });
+   _update_trigger(*collateral_itr, *itr);
    _gstate.total_interest_quant  += total_unpaid_interest;
    _gstate.avl_principal_quant   += principal_repay_quant;
 }
@@ -189,7 +211,7 @@ void tyche_loan::getmoreusdt(const name& from, const symbol& callat_sym, const a
    auto loaner_itr = loaner.find(from.value);
    CHECKC(loaner_itr != loaner.end(), err::RECORD_NOT_FOUND, "account not existed");
 
-   asset total_interest = _get_dynamic_interest(loaner_itr->avl_principal, loaner_itr->term_settled_at, eosio::current_time_point());
+   asset total_interest = _get_accrued_interest(*loaner_itr);
    auto total_principal = loaner_itr->avl_principal + loaner_itr->unpaid_interest + total_interest + quant;
    auto ratio = get_callation_ratio(loaner_itr->avl_collateral_quant, total_principal, itr->oracle_sym_name);
    CHECKC( ratio >= itr->liquidation_ratio, err::RATE_EXCEEDED, "callation ratio exceeded: "+ to_string(ratio) +
@@ -206,7 +228,9 @@ void tyche_loan::getmoreusdt(const name& from, const symbol& callat_sym, const a
       row.avl_principal    += quant;
       row.unpaid_interest  += total_interest;
       row.term_settled_at  = eosio::current_time_point();
+      _set_settled_index(row);
    });
+   _update_trigger(*itr, *loaner_itr);
 
    syms.modify(itr, _self, [&](auto& row){
       row.total_principal += quant;
@@ -256,7 +280,7 @@ void tyche_loan::_on_add_callateral( const name& from, const name& token_bank, c
    loaner_t::tbl_t loaners(_self, _get_lower(quant.symbol).value);
    auto itr = loaners.find(from.value);
    if( itr == loaners.end() ){
-      loaners.emplace(_self, [&](auto& row){
+      itr = loaners.emplace(_self, [&](auto& row){
          row.owner = from;
          row.cum_collateral_quant   = quant;
          row.avl_collateral_quant   = quant;
@@ -264,6 +288,7 @@ void tyche_loan::_on_add_callateral( const name& from, const name& token_bank, c
          row.created_at             = eosio::current_time_point();
          row.term_started_at        = eosio::current_time_point();
          row.term_settled_at        = eosio::current_time_point();
+         _set_settled_index(row);
          row.term_ended_at          = eosio::current_time_point() + eosio::days(_gstate.term_interval_days);
          row.unpaid_interest        = asset(0, _gstate.loan_token.get_symbol());
          row.paid_interest          = asset(0, _gstate.loan_token.get_symbol());
@@ -274,6 +299,7 @@ void tyche_loan::_on_add_callateral( const name& from, const name& token_bank, c
          row.avl_collateral_quant += quant;
       });
    }
+   _update_trigger(*sym_itr, *itr);
 
    syms.modify(sym_itr, _self, [&](auto& row){
       row.total_collateral_quant += quant;
@@ -306,6 +332,7 @@ void tyche_loan::onsubcallat( const name& from, const asset& quant ) {
    loaners.modify(itr, _self, [&](auto& row){
       row.avl_collateral_quant = remain_collateral_quant;
    });
+   _update_trigger(*sym_itr, *itr);
 
    syms.modify(sym_itr, _self, [&](auto& row){
       row.avl_collateral_quant   -= quant;
@@ -339,20 +366,33 @@ asset tyche_loan::calc_collateral_quant( const asset& collateral_quant, const as
 }
 
 uint64_t tyche_loan::get_index_price( const name& base_code ){
-    const auto& prices = _price_conf().prices;
-    auto itr =  prices.find(base_code);
-    CHECKC(itr != prices.end(), err::RECORD_NOT_FOUND, "price not found: " + base_code.to_string()  )
-    return itr->second;
-}
-
-const price_global_t& tyche_loan::_price_conf() {
-    if(!_global_prices_ptr) {
-        CHECKC(_gstate.price_oracle_contract.value != 0,err::SYSTEM_ERROR, "Invalid price_oracle_contract");
-        _global_prices_tbl_ptr =  std::make_unique<price_global_t::idx_t>(_gstate.price_oracle_contract, _gstate.price_oracle_contract.value);
-        _global_prices_ptr = std::make_unique<price_global_t>(_global_prices_tbl_ptr->get());
-    }
-   TRACE_L("_price_conf end");
-   return *_global_prices_ptr;
+   auto cached = _index_prices.find(base_code);
+   if( cached != _index_prices.end() )
+      return cached->second;
+
+   CHECKC(_gstate.price_oracle_contract.value != 0, err::SYSTEM_ERROR, "Invalid price_oracle_contract");
+   //只读该币种的最新一条, 不再反序列化预言机 global 中全部币种的价格
+   auto prices    = coin_price_t::idx_t(_gstate.price_oracle_contract, base_code.value);
+   auto time_idx  = prices.get_index<"bytime"_n>();
+   auto itr       = time_idx.end();
+   CHECKC(itr != time_idx.begin(), err::RECORD_NOT_FOUND, "price not found: " + base_code.to_string() )
+   itr--;
+
+   auto max_age   = _gstate.max_price_age_sec.value_or(DEFAULT_MAX_PRICE_AGE_SEC);
+   auto age       = (eosio::current_time_point() - itr->updated_at).to_seconds();
+   CHECKC(max_age == 0 || age <= (int64_t)max_age, err::TIME_EXPIRED, "price expired: " + base_code.to_string() + ", age: " + to_string(age) )
+   CHECKC(itr->price.amount > 0, err::INCORRECT_AMOUNT, "invalid price: " + base_code.to_string() )
+
+   int64_t price        = itr->price.amount;
+   auto price_digit     = itr->price.symbol.precision();
+   auto loan_digit      = _gstate.loan_token.get_symbol().precision();
+   if( price_digit < loan_digit )
+      price             *= calc_precision(loan_digit - price_digit);
+   else if( price_digit > loan_digit )
+      price             /= calc_precision(price_digit - loan_digit);
+
+   _index_prices[base_code] = price;
+   return price;
 }
 
 /***
@@ -376,7 +416,7 @@ void tyche_loan::_liquidate( const name& from, const name& liquidator, const sym
    collateral_quant = loaner_itr->avl_collateral_quant;
    principal_quant  = loaner_itr->avl_principal;
 
-   asset total_interest = _get_dynamic_interest(loaner_itr->avl_principal, loaner_itr->term_settled_at, eosio::current_time_point());
+   asset total_interest = _get_accrued_interest(*loaner_itr);
    asset need_pay_interest = loaner_itr->unpaid_interest + total_interest;
    asset need_settle_quant = loaner_itr->avl_principal + need_pay_interest;
    auto ratio = get_callation_ratio(loaner_itr->avl_collateral_quant, need_settle_quant, itr->oracle_sym_name);
@@ -393,17 +433,14 @@ void tyche_loan::_liquidate( const name& from, const name& liquidator, const sym
       auto max_paid_quant = asset(max_paid_amount, need_settle_quant.symbol);
       if( max_paid_quant <= quant) {
          auto return_quant = quant - max_paid_quant;
-         TRANSFER( _gstate.loan_token.get_contract(), from, return_quant, TYPE_GIVE_CHANGE_LIQ + ":" + symbol_to_string(itr->sym.get_symbol()) );
+         TRANSFER( _gstate.loan_token.get_contract(), from, return_quant, TYPE_GIVE_CHANGE_LIQ );
          liquidator_pay_usdt_quant = max_paid_quant;
       }
 
       //按当前价格的97% 结算给用户
       auto return_collateral_quant = calc_collateral_quant(loaner_itr->avl_collateral_quant, liquidator_pay_usdt_quant, itr->oracle_sym_name, settle_price);
       //把抵押物转给协议平仓的人
-      TRANSFER( itr->sym.get_contract(), from, return_collateral_quant, TYPE_BUY + ":" + symbol_to_string(itr->sym.get_symbol()) + ":" + "principal," +loaner_itr->avl_principal.to_string() + "," + "interest," + total_interest.to_string() + ","
-                  + "unpaid_interest," + loaner_itr->unpaid_interest.to_string() +  ", "
-                     "term_settled_at:" + to_string(loaner_itr->term_settled_at.sec_since_epoch()) +
-                     ",end_at:" + to_string(time_point_sec(eosio::current_time_point()).sec_since_epoch()));
+      TRANSFER( itr->sym.get_contract(), from, return_collateral_quant, TYPE_BUY );
       //平台内结算
       //添加平台金额
       auto platform_quant_amount = multiply_decimal64(liquidator_pay_usdt_quant.amount, (PCT_BOOST - _gstate.liquidation_penalty_ratio), PCT_BOOST );
@@ -412,18 +449,19 @@ void tyche_loan::_liquidate( const name& from, const name& liquidator, const sym
       CHECKC( paid_principal.amount > 0, err::INCORRECT_AMOUNT, "paid_principal must positive" )
       CHECKC( paid_principal <= loaner_itr->avl_principal, err::INCORRECT_AMOUNT, "principal need < avl_principal" )
       _add_fee(platform_quant);
-      //结算用户质押物
-      NOTIFY_TRANSFER_ACTION(liquidator, _self, paid_principal, TYPE_SEND_BACK_INTERNAL_LIQ  +":" + symbol_to_string(itr->sym.get_symbol()) );
-
-      //通知转账消息用户MUSDT -> 平台
-      NOTIFY_TRANSFER_ACTION(liquidator, _self, return_collateral_quant, TYPE_LIQUIDATE_INTERNAL + ":"+ symbol_to_string(itr->sym.get_symbol()));
+      std::vector<liqleg_t> legs = {
+         { LEG_SEND_BACK_LIQ,  liquidator, _self, paid_principal },           //结算用户本金
+         { LEG_LIQUIDATE,      liquidator, _self, return_collateral_quant }   //用户抵押物 -> 清算人
+      };
       loaner.modify(loaner_itr, _self, [&](auto& row){
          row.avl_collateral_quant   -= return_collateral_quant;              //减少抵押物
          row.avl_principal          -= paid_principal;
          row.unpaid_interest        = asset(0, _gstate.loan_token.get_symbol());
          row.paid_interest          += need_pay_interest;
          row.term_settled_at        = eosio::current_time_point();
+         _set_settled_index(row);
       });
+      _update_trigger(*itr, *loaner_itr);
 
       _gstate.total_interest_quant += need_pay_interest;
 
@@ -439,11 +477,12 @@ void tyche_loan::_liquidate( const name& from, const name& liquidator, const sym
          current_price, settle_price,
          need_pay_interest, platform_quant,
          ratio, eosio::current_time_point()};
-      NOTIFY_LIQ_ACTION(liqlog);
+      _record_liqs({ liqlog });
+      NOTIFY_LIQ_EVENT(liqlog, legs);
       return;
    } else {
       if( quant.amount > 0 ){
-         TRANSFER( _gstate.loan_token.get_contract(), from, quant, TYPE_GIVE_CHANGE_CLOSE + ":"+ symbol_to_string(itr->sym.get_symbol()) );
+         TRANSFER( _gstate.loan_token.get_contract(), from, quant, TYPE_GIVE_CHANGE_CLOSE );
       }
       syms.modify(itr, _self, [&](auto& row){
          row.total_force_collateral_quant  += loaner_itr->avl_collateral_quant;
@@ -461,10 +500,10 @@ void tyche_loan::_liquidate( const name& from, const name& liquidator, const sym
          current_price, current_price,
          need_pay_interest, asset(0, quant.symbol),
          ratio, eosio::current_time_point()};
-         //通知转账消息用户METH -> 平台
-      NOTIFY_TRANSFER_ACTION(liquidator, _self, loaner_itr->avl_collateral_quant, TYPE_FORCECLOSE_INTRENAL + ":" + symbol_to_string(itr->sym.get_symbol()));
-      //通知转账消息用户MUSDT -> 平台
-      NOTIFY_TRANSFER_ACTION(liquidator, _self, loaner_itr->avl_principal, TYPE_SEND_BACK_INTERNAL_CLOSE+ ":" + symbol_to_string(itr->sym.get_symbol())+ ":" + TYPE_SEND_BACK);
+      std::vector<liqleg_t> legs = {
+         { LEG_FORCECLOSE,       liquidator, _self, collateral_quant },      //用户抵押物 -> 平台
+         { LEG_SEND_BACK_CLOSE,  liquidator, _self, principal_quant }        //用户本金由平台承接
+      };
       //直接没收抵押物
       loaner.modify(loaner_itr, _self, [&](auto& row){
          row.avl_collateral_quant   = asset(0, itr->sym.get_symbol());              //减少抵押物
@@ -472,13 +511,132 @@ void tyche_loan::_liquidate( const name& from, const name& liquidator, const sym
          row.unpaid_interest        = asset(0, _gstate.loan_token.get_symbol());
          row.paid_interest          += need_pay_interest;
          row.term_settled_at        = eosio::current_time_point();
+         _set_settled_index(row);
       });
-      NOTIFY_LIQ_ACTION(liqlog);
+      _update_trigger(*itr, *loaner_itr);
+      _record_liqs({ liqlog });
+      NOTIFY_LIQ_EVENT(liqlog, legs);
       _gstate.total_interest_quant += need_pay_interest;
 
    }
 }
 
+void tyche_loan::_liquidate_batch( const name& from, const symbol& callat_sym, const std::vector<name>& liquidators, const asset& quant ){
+   CHECKC( quant.amount >= 0, err::INCORRECT_AMOUNT, "amount must positive" )
+   CHECKC( liquidators.size() > 0 && liquidators.size() <= MAX_LIQ_BATCH_SIZE, err::PARAMETER_INVALID,
+           "liquidators size must be in [1, " + to_string(MAX_LIQ_BATCH_SIZE) + "]" )
+   auto syms = collateral_symbol_t::idx_t(_self, _self.value);
+   auto itr = syms.find(callat_sym.code().raw());
+   CHECKC(itr != syms.end(), err::SYMBOL_MISMATCH, "symbol not supported");
+
+   auto loaner          = loaner_t::tbl_t(_self, _get_lower(callat_sym).value);
+   auto price           = get_index_price( itr->oracle_sym_name );
+   auto current_price   = asset( price, quant.symbol );
+   auto now             = eosio::current_time_point();
+
+   asset remain_quant            = quant;                       //清算人剩余 MUSDT
+   asset bought_collateral_quant = asset(0, callat_sym);        //清算人买到的抵押物
+   asset platform_fee_quant      = asset(0, quant.symbol);
+   asset paid_interest_quant     = asset(0, quant.symbol);
+   asset force_collateral_quant  = asset(0, callat_sym);
+   asset force_principal_quant   = asset(0, quant.symbol);
+   std::vector<liqlog_t> liqlogs;
+   std::vector<liqleg_t> legs;
+   std::set<name> handled;
+
+   for( const auto& liquidator : liquidators ) {
+      if( !handled.insert(liquidator).second ) continue;
+      auto loaner_itr = loaner.find(liquidator.value);
+      if( loaner_itr == loaner.end() ) continue;
+
+      auto collateral_quant   = loaner_itr->avl_collateral_quant;
+      auto principal_quant    = loaner_itr->avl_principal;
+      auto need_pay_interest  = loaner_itr->unpaid_interest + _get_accrued_interest(*loaner_itr);
+      auto need_settle_quant  = principal_quant + need_pay_interest;
+      if( need_settle_quant.amount <= 0 ) continue;
+      auto ratio = get_callation_ratio(collateral_quant, need_settle_quant, itr->oracle_sym_name);
+      if( ratio > itr->liquidation_ratio ) continue;
+
+      if( ratio > itr->force_liquidate_ratio ) {
+         //清算: 按账户顺序用剩余 MUSDT 购买抵押物, 不够支付利息的跳过
+         if( remain_quant < need_pay_interest ) continue;
+         auto max_paid_quant  = asset(divide_decimal(need_settle_quant.amount, _gstate.liquidation_penalty_ratio, PCT_BOOST), quant.symbol);
+         auto pay_quant       = std::min(remain_quant, max_paid_quant);
+         auto platform_quant  = asset(multiply_decimal64(pay_quant.amount, (PCT_BOOST - _gstate.liquidation_penalty_ratio), PCT_BOOST), quant.symbol);
+         auto paid_principal  = pay_quant - platform_quant - need_pay_interest;
+         if( paid_principal.amount <= 0 || paid_principal > principal_quant ) continue;
+
+         asset settle_price   = asset(0, quant.symbol);
+         auto paid_collateral_quant = calc_collateral_quant(collateral_quant, pay_quant, itr->oracle_sym_name, settle_price);
+         loaner.modify(loaner_itr, _self, [&](auto& row){
+            row.avl_collateral_quant   -= paid_collateral_quant;
+            row.avl_principal          -= paid_principal;
+            row.unpaid_interest        = asset(0, _gstate.loan_token.get_symbol());
+            row.paid_interest          += need_pay_interest;
+            row.term_settled_at        = now;
+            _set_settled_index(row);
+         });
+         remain_quant               -= pay_quant;
+         bought_collateral_quant    += paid_collateral_quant;
+         platform_fee_quant         += platform_quant;
+
+         liqlogs.push_back({_global_state->new_liqlog_id(),
+            "liq"_n, from, liquidator,
+            collateral_quant, paid_collateral_quant,
+            principal_quant, pay_quant,
+            current_price, settle_price,
+            need_pay_interest, platform_quant,
+            ratio, now});
+         legs.push_back({ LEG_SEND_BACK_LIQ,  liquidator, _self, paid_principal });
+         legs.push_back({ LEG_LIQUIDATE,      liquidator, _self, paid_collateral_quant });
+      } else {
+         //强平: 与 forceliq 一致, 抵押率 <= force_liquidate_ratio 即强平
+         loaner.modify(loaner_itr, _self, [&](auto& row){
+            row.avl_collateral_quant   = asset(0, itr->sym.get_symbol());
+            row.avl_principal          = asset(0, _gstate.loan_token.get_symbol());
+            row.unpaid_interest        = asset(0, _gstate.loan_token.get_symbol());
+            row.paid_interest          += need_pay_interest;
+            row.term_settled_at        = now;
+            _set_settled_index(row);
+         });
+         force_collateral_quant     += collateral_quant;
+         force_principal_quant      += principal_quant;
+
+         liqlogs.push_back({_global_state->new_liqlog_id(),
+            "forceliq"_n, from, liquidator,
+            collateral_quant, collateral_quant,
+            principal_quant, principal_quant,
+            current_price, current_price,
+            need_pay_interest, asset(0, quant.symbol),
+            ratio, now});
+         legs.push_back({ LEG_FORCECLOSE,       liquidator, _self, collateral_quant });
+         legs.push_back({ LEG_SEND_BACK_CLOSE,  liquidator, _self, principal_quant });
+      }
+      paid_interest_quant += need_pay_interest;
+      _update_trigger(*itr, *loaner_itr);
+   }
+   CHECKC( liqlogs.size() > 0, err::RECORD_NOT_FOUND, "no account can be liquidated" )
+
+   if( force_collateral_quant.amount > 0 || force_principal_quant.amount > 0 ) {
+      syms.modify(itr, _self, [&](auto& row){
+         row.total_force_collateral_quant  += force_collateral_quant;
+         row.total_force_principal         += force_principal_quant;
+         row.avl_force_collateral_quant    += force_collateral_quant;
+         row.avl_force_principal           += force_principal_quant;
+      });
+   }
+   if( platform_fee_quant.amount > 0 )
+      _add_fee(platform_fee_quant);
+   _gstate.total_interest_quant += paid_interest_quant;
+
+   if( bought_collateral_quant.amount > 0 )
+      TRANSFER( itr->sym.get_contract(), from, bought_collateral_quant, TYPE_BUY );
+   if( remain_quant.amount > 0 )
+      TRANSFER( _gstate.loan_token.get_contract(), from, remain_quant, TYPE_GIVE_CHANGE_LIQ );
+   _record_liqs(liqlogs);
+   NOTIFY_LIQ_BATCH(liqlogs, legs);
+}
+
 void tyche_loan::setcallatsym(const extended_symbol& sym, const name& oracle_sym_name) {
    require_auth(_gstate.admin);
    auto syms = collateral_symbol_t::idx_t(_self, _self.value);
@@ -514,11 +672,28 @@ void tyche_loan::setsymratio(const symbol& sym, const uint64_t& init_ratio, cons
 
    auto syms = collateral_symbol_t::idx_t(_self, _self.value);
    auto itr = syms.find(sym.code().raw());
+   CHECKC(itr != syms.end(), err::SYMBOL_MISMATCH, "symbol not supported");
+   bool trigger_changed = itr->liquidation_ratio != liq_ratio || itr->force_liquidate_ratio != force_ratio;
     syms.modify(itr, _self, [&](auto& row){
          row.init_collateral_ratio  = init_ratio;
          row.liquidation_ratio      = liq_ratio;
          row.force_liquidate_ratio  = force_ratio;
    });
+   if( !trigger_changed ) return;
+
+   //触发价待重建, 由 updtriggers 从头分批重算
+   auto cursors   = trigger_cursor_t::tbl_t(_self, _self.value);
+   auto cursor    = cursors.find(sym.code().raw());
+   auto restart   = [&](auto& c){
+      c.sym          = itr->sym.get_symbol();
+      c.next_owner   = name();
+      c.processed    = 0;
+      c.updated_at   = eosio::current_time_point();
+   };
+   if( cursor == cursors.end() )
+      cursors.emplace(_self, restart);
+   else
+      cursors.modify(cursor, _self, restart);
 }
 
 void tyche_loan::setcollquant(const symbol& sym, const asset& min_collateral_quant, const asset& max_collateral_quant){
@@ -549,6 +724,14 @@ void tyche_loan::addinterest(const uint64_t& interest_ratio) {
    require_auth(_gstate.admin);
    CHECKC(interest_ratio > 0, err::INCORRECT_AMOUNT, "interest_ratio must positive")
 
+   //按旧利率结转累计指数
+   _init_interest_index();
+   auto index = _get_interest_index().value();
+   _interest_index_ptr->cum_index      = index;
+   _interest_index_ptr->interest_ratio = interest_ratio;
+   _interest_index_ptr->updated_at     = eosio::current_time_point();
+   _interest_index_tbl.set(*_interest_index_ptr, _self);
+
    auto interests = interest_t::tbl_t(_self, _self.value);
    auto first_itr =  interests.begin();
    if( first_itr != interests.end() ) {
@@ -569,6 +752,11 @@ void tyche_loan::setliqpratio(const uint64_t& liquidation_price_ratio){
    _gstate.liquidation_price_ratio =  liquidation_price_ratio;
 }
 
+void tyche_loan::setpriceage(const uint64_t& max_price_age_sec){
+   require_auth(_gstate.admin);
+   _gstate.max_price_age_sec       = max_price_age_sec;
+}
+
 uint64_t tyche_loan::_get_current_interest_ratio() {
    require_auth(_gstate.admin);
 
@@ -591,7 +779,9 @@ asset tyche_loan::_get_dynamic_interest( const asset& quant,
    auto ended_at  = time_end;
    auto interest = asset(0, quant.symbol);
 
+   work_budget budget( INTEREST_HISTORY_BUDGET );
    while( beg_itr != interests.end() && beg_itr->ended_at > time_start ) {
+      CHECKC( budget.spend(), err::OVERSIZED, "interest history too long, call settlehist first" )
       if( beg_itr->begin_at > time_start ) {
          begin_at = beg_itr->begin_at;
       }
@@ -602,6 +792,51 @@ asset tyche_loan::_get_dynamic_interest( const asset& quant,
    return interest;
 }
 
+void tyche_loan::_init_interest_index() {
+   if( _interest_index_ptr || _interest_index_tbl.exists() ) return;
+
+   //以当前利率为起点, 未记录指数的用户仍按 interests 历史结算
+   _interest_index_ptr = std::make_unique<interest_index_t>();
+   auto interests       = interest_t::tbl_t(_self, _self.value);
+   auto first_itr       = interests.begin();
+   if( first_itr != interests.end() )
+      _interest_index_ptr->interest_ratio = first_itr->interest_ratio;
+   _interest_index_ptr->updated_at      = eosio::current_time_point();
+   _interest_index_tbl.set(*_interest_index_ptr, _self);
+}
+
+std::optional<int128_t> tyche_loan::_get_interest_index() {
+   if( !_interest_index_ptr ) {
+      if( !_interest_index_tbl.exists() )
+         return std::nullopt;
+      _interest_index_ptr = std::make_unique<interest_index_t>(_interest_index_tbl.get());
+   }
+   auto elapsed_seconds = time_point_sec(eosio::current_time_point()).sec_since_epoch() - _interest_index_ptr->updated_at.sec_since_epoch();
+   return _interest_index_ptr->cum_index
+        + wad::from_ratio( (int128_t)_interest_index_ptr->interest_ratio * elapsed_seconds, (int128_t)PCT_BOOST * YEAR_SECONDS ).raw;
+}
+
+void tyche_loan::_set_settled_index( loaner_t& loaner ) {
+   auto index = _get_interest_index();
+   if( index.has_value() )
+      loaner.settled_index = *index;
+   else
+      loaner.settled_index.reset();
+}
+
+asset tyche_loan::_get_accrued_interest( const loaner_t& loaner ) {
+   if( !loaner.settled_index.has_value() )
+      return _get_dynamic_interest(loaner.avl_principal, loaner.term_settled_at, eosio::current_time_point());
+
+   auto index           = _get_interest_index();
+   CHECKC( index.has_value(), err::SYSTEM_ERROR, "interest index not initialized" )
+   int128_t index_delta = *index - loaner.settled_index.value();
+   CHECKC( index_delta >= 0, err::SYSTEM_ERROR, "interest index decreased" )
+   int128_t interest    = wad::from_raw( index_delta ).times( loaner.avl_principal.amount );
+   CHECKC( interest <= std::numeric_limits<int64_t>::max(), err::SYSTEM_ERROR, "interest overflow" )
+   return asset( (int64_t)interest, loaner.avl_principal.symbol );
+}
+
 asset tyche_loan::_get_interest(const asset& quant, const uint64_t& interest_ratio,
                                  const time_point_sec& started_at, const time_point_sec& ended_at) {
       auto elapsed =  (ended_at - started_at);
@@ -624,7 +859,7 @@ void tyche_loan::forceliq( const name& from, const name& liquidator, const symbo
    auto collateral_quant = loaner_itr->avl_collateral_quant;
    auto principal_quant  = loaner_itr->avl_principal;
 
-   asset total_interest = _get_dynamic_interest(loaner_itr->avl_principal, loaner_itr->term_settled_at, eosio::current_time_point() );
+   asset total_interest = _get_accrued_interest(*loaner_itr);
    asset need_pay_interest = loaner_itr->unpaid_interest + total_interest;
    asset need_settle_quant = loaner_itr->avl_principal + need_pay_interest;
    auto ratio = get_callation_ratio(loaner_itr->avl_collateral_quant, need_settle_quant, itr->oracle_sym_name);
@@ -648,11 +883,12 @@ void tyche_loan::forceliq( const name& from, const name& liquidator, const symbo
       current_price, current_price,
       need_pay_interest, asset(0, itr->avl_principal.symbol),
       ratio, eosio::current_time_point()};
-   NOTIFY_LIQ_ACTION(liqlog);
-   //通知转账消息用户METH -> 平台
-   NOTIFY_TRANSFER_ACTION(liquidator, _self, loaner_itr->avl_collateral_quant, TYPE_FORCECLOSE_INTRENAL + ":" + symbol_to_string(itr->sym.get_symbol()));
-   //通知转账消息用户MUSDT -> 平台
-   NOTIFY_TRANSFER_ACTION(liquidator, _self, loaner_itr->avl_principal, TYPE_SEND_BACK_INTERNAL_CLOSE + ":" + symbol_to_string(itr->sym.get_symbol()));
+   std::vector<liqleg_t> legs = {
+      { LEG_FORCECLOSE,       liquidator, _self, collateral_quant },      //用户抵押物 -> 平台
+      { LEG_SEND_BACK_CLOSE,  liquidator, _self, principal_quant }        //用户本金由平台承接
+   };
+   _record_liqs({ liqlog });
+   NOTIFY_LIQ_EVENT(liqlog, legs);
    //直接没收抵押物
    loaner.modify(loaner_itr, _self, [&](auto& row){
       row.avl_collateral_quant   = asset(0, itr->sym.get_symbol());              //减少抵押物
@@ -660,10 +896,187 @@ void tyche_loan::forceliq( const name& from, const name& liquidator, const symbo
       row.unpaid_interest        = asset(0, _gstate.loan_token.get_symbol());
       row.paid_interest          += need_pay_interest;
       row.term_settled_at        = eosio::current_time_point();
+      _set_settled_index(row);
    });
+   _update_trigger(*itr, *loaner_itr);
    _gstate.total_interest_quant += need_pay_interest;
 }
 
+void tyche_loan::forceliqs( const name& from, const symbol& callat_sym, const std::vector<name>& liquidators ){
+   require_auth(from);
+   _liquidate_batch(from, callat_sym, liquidators, asset(0, _gstate.loan_token.get_symbol()));
+}
+
+void tyche_loan::_update_trigger( const collateral_symbol_t& coll, const loaner_t& loaner ) {
+   auto triggers     = loan_trigger_t::tbl_t(_self, _get_lower(coll.sym.get_symbol()).value);
+   auto itr          = triggers.find(loaner.owner.value);
+   auto debt         = loaner.avl_principal + loaner.unpaid_interest;
+   if( debt.amount <= 0 ) {
+      if( itr != triggers.end() ) triggers.erase(itr);
+      return;
+   }
+
+   auto liq_price    = calc_trigger_price(loaner.avl_collateral_quant, debt, coll.liquidation_ratio);
+   auto force_price  = calc_trigger_price(loaner.avl_collateral_quant, debt, coll.force_liquidate_ratio);
+   if( itr == triggers.end() ) {
+      triggers.emplace(_self, [&](auto& row){
+         row.owner         = loaner.owner;
+         row.liq_price     = liq_price;
+         row.force_price   = force_price;
+      });
+   } else if( itr->liq_price != liq_price || itr->force_price != force_price ) {
+      triggers.modify(itr, _self, [&](auto& row){
+         row.liq_price     = liq_price;
+         row.force_price   = force_price;
+      });
+   }
+}
+
+void tyche_loan::updtriggers(const symbol& callat_sym, const name& start, const uint32_t& max_rows) {
+   require_auth(_gstate.admin);
+   CHECKC(max_rows > 0, err::PARAM_ERROR, "max_rows must be positive")
+   auto syms      = collateral_symbol_t::idx_t(_self, _self.value);
+   auto sym_itr   = syms.find(callat_sym.code().raw());
+   CHECKC(sym_itr != syms.end(), err::SYMBOL_MISMATCH, "symbol not supported");
+
+   auto cursors   = trigger_cursor_t::tbl_t(_self, _self.value);
+   auto cursor    = cursors.find(callat_sym.code().raw());
+   auto from      = start;
+   if( from.value == 0 && cursor != cursors.end() )
+      from        = cursor->next_owner;
+
+   auto loaners   = loaner_t::tbl_t(_self, _get_lower(callat_sym).value);
+   auto itr       = loaners.lower_bound(from.value);
+   uint32_t rows  = 0;
+   for( ; rows < max_rows && itr != loaners.end(); rows++, itr++ ) {
+      _update_trigger(*sym_itr, *itr);
+   }
+
+   if( itr == loaners.end() ) {
+      if( cursor != cursors.end() ) cursors.erase(cursor);
+      return;
+   }
+   auto set_cursor = [&](auto& c){
+      c.sym          = sym_itr->sym.get_symbol();
+      c.next_owner   = itr->owner;
+      c.processed    += rows;
+      c.updated_at   = eosio::current_time_point();
+   };
+   if( cursor == cursors.end() )
+      cursors.emplace(_self, set_cursor);
+   else
+      cursors.modify(cursor, _self, set_cursor);
+}
+
+void tyche_loan::settlehist(const symbol& callat_sym, const name& owner) {
+   CHECKC( has_auth(owner) || has_auth(_gstate.admin), err::NO_AUTH, "no auth for operate" )
+   auto syms      = collateral_symbol_t::idx_t(_self, _self.value);
+   auto sym_itr   = syms.find(callat_sym.code().raw());
+   CHECKC(sym_itr != syms.end(), err::SYMBOL_MISMATCH, "symbol not supported");
+
+   auto loaners   = loaner_t::tbl_t(_self, _get_lower(callat_sym).value);
+   auto itr       = loaners.find(owner.value);
+   CHECKC(itr != loaners.end(), err::RECORD_NOT_FOUND, "account not existed");
+   CHECKC(!itr->settled_index.has_value(), err::ACTION_REDUNDANT, "interest already indexed");
+
+   //从 term_settled_at 所在的利率区间起按时间正序逐区间计息, 按实际时长计满每个区间, 与 settled_index 指数结算一致
+   //与 _get_dynamic_interest 不同: 跨越多个区间时, 旧算法不计 term_settled_at 所在区间(起点至下一区间开始)的利息
+   //结算到的区间边界写回 term_settled_at, 即下一次的起点
+   auto now        = time_point_sec(eosio::current_time_point());
+   auto settled_at = itr->term_settled_at;
+   auto interest   = asset(0, itr->avl_principal.symbol);
+   auto interests  = interest_t::tbl_t(_self, _self.value);
+   auto period     = interests.lower_bound(UINT64_MAX - (uint64_t)settled_at.utc_seconds);
+   if( period == interests.end() && period != interests.begin() )
+      period--;      //早于所有区间: 从最早的区间开始
+
+   bool done       = true;
+   work_budget budget( INTEREST_HISTORY_BUDGET );
+   while( period != interests.end() ) {
+      if( !budget.spend() ) {
+         done      = false;
+         break;
+      }
+      auto newest   = period == interests.begin();
+      auto begin_at = period->begin_at > settled_at ? period->begin_at : settled_at;
+      auto ended_at = newest ? now : std::prev(period)->begin_at;
+      interest      += _get_interest(itr->avl_principal, period->interest_ratio, begin_at, ended_at);
+      settled_at    = ended_at;
+      if( newest ) break;
+      period--;
+   }
+   if( done ) settled_at = now;
+
+   loaners.modify(itr, _self, [&](auto& row){
+      row.unpaid_interest  += interest;
+      row.term_settled_at  = settled_at;
+      if( done )
+         _set_settled_index(row);
+   });
+   _update_trigger(*sym_itr, *itr);
+}
+
+name tyche_loan::migraterows(const symbol& callat_sym, const name& start, const uint32_t& max_rows) {
+   require_auth(_gstate.admin);
+   CHECKC(max_rows > 0, err::PARAM_ERROR, "max_rows must be positive")
+   auto syms      = collateral_symbol_t::idx_t(_self, _self.value);
+   CHECKC(syms.find(callat_sym.code().raw()) != syms.end(), err::SYMBOL_MISMATCH, "symbol not supported");
+
+   //升级前部署的合约在此建立累计利率指数
+   _init_interest_index();
+   auto loaners   = loaner_t::tbl_t(_self, _get_lower(callat_sym).value);
+   auto next      = migrate_rows(loaners, start.value, max_rows);
+   return next.has_value() ? name(*next) : name();
+}
+
+void tyche_loan::_record_liqs( const std::vector<liqlog_t>& liqlogs ) {
+   if( liqlogs.empty() ) return;
+
+   auto recent_liqs = recent_liq_t::tbl_t(_self, _self.value);
+   for( const auto& liqlog : liqlogs ) {
+      auto slot = liqlog.id % RECENT_LIQ_CAPACITY;
+      auto itr  = recent_liqs.find(slot);
+      if( itr == recent_liqs.end() ) {
+         recent_liqs.emplace(_self, [&](auto& row){
+            row.slot    = slot;
+            row.liqlog  = liqlog;
+         });
+      } else {
+         //行大小固定, 覆盖不增加 RAM
+         recent_liqs.modify(itr, same_payer, [&](auto& row){
+            row.liqlog  = liqlog;
+         });
+      }
+   }
+
+   auto coll_sym  = liqlogs.front().collateral_quant.symbol;
+   auto stats     = liq_stat_t::tbl_t(_self, _self.value);
+   auto stat_itr  = stats.find(coll_sym.code().raw());
+   auto update    = [&](auto& row){
+      for( const auto& liqlog : liqlogs ) {
+         if( liqlog.liqtype == "forceliq"_n ) {
+            row.force_count++;
+            row.force_collateral_quant += liqlog.paid_collateral_quant;
+         } else {
+            row.liq_count++;
+            row.liq_collateral_quant   += liqlog.paid_collateral_quant;
+         }
+         row.last_liqlog_id   = liqlog.id;
+         row.last_liq_at      = liqlog.deal_time;
+      }
+   };
+   if( stat_itr == stats.end() ) {
+      stats.emplace(_self, [&](auto& row){
+         row.sym                    = coll_sym;
+         row.liq_collateral_quant   = asset(0, coll_sym);
+         row.force_collateral_quant = asset(0, coll_sym);
+         update(row);
+      });
+   } else {
+      stats.modify(stat_itr, same_payer, update);
+   }
+}
+
 void tyche_loan::_add_fee(const asset& quantity) {
    auto fees           = make_fee_table( get_self() );
    auto it             = fees.find( quantity.symbol.code().raw() );
@@ -690,12 +1103,12 @@ asset tyche_loan::_sub_fee(const symbol& sym) {
    });
    return quant;
 }
-void tyche_loan::notifyliq( const liqlog_t& liqlog ){
+void tyche_loan::liqevent( const liqlog_t&, const std::vector<liqleg_t>& ){
    require_auth(get_self());
    require_recipient(get_self());
 }
 
-void tyche_loan::notifytran(const name& from, const name& to, const asset& quants, const string& memo){
+void tyche_loan::liqbatch( const std::vector<liqlog_t>&, const std::vector<liqleg_t>& ){
    require_auth(get_self());
    require_recipient(get_self());
 }
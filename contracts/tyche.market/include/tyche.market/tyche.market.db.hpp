@@ -4,6 +4,9 @@
 #include <eosio/eosio.hpp>
 #include <eosio/time.hpp>
 
+#include <tyche.common/fixed_point.hpp>
+#include <tyche.common/row_version.hpp>
+
 namespace tychefi {
 
 using namespace eosio;
@@ -14,7 +17,7 @@ using namespace eosio;
 static constexpr uint64_t RATE_SCALE        = 10'000;                     // 利率基数（bps）
 static constexpr uint32_t SECONDS_PER_YEAR  = 31'536'000;                // 年秒数
 static constexpr uint64_t MAX_PRICE_CHANGE_BP = 2000;                    // 单次最大价格变动（20%）
-static constexpr uint128_t HIGH_PRECISION   = 1'000'000'000'000'000'000ULL; // 1e18
+static constexpr uint32_t MAX_RESERVES      = 32;                        // 估值须一次遍历用户全部仓位，仓位数不超过 reserve 数
 static constexpr symbol USDT_SYM            = symbol("USDT", 6);
 
 // =====================================================
@@ -80,7 +83,7 @@ using prices_t = multi_index<"prices"_n, price_feed>;
 // =====================================================
 struct borrow_index_st {
     uint64_t        id = 0;                     // 单调递增版本号
-    uint128_t       index = HIGH_PRECISION;     // 累计倍率（1e18 起）
+    uint128_t       index = wad::one;           // 累计倍率（wad, 1e18 起）
     uint64_t        borrow_rate_bp = 0;         // 当前年化借款利率
     time_point_sec  last_updated;               // 上次 accrue 时间
 };
@@ -174,11 +177,19 @@ NTBL("reserves") reserve_state {
 
     bool        paused = false;
 
+    // -------- layout --------
+    binary_extension<uint8_t> row_version;   // 存储时的行版本，写入时总是 ROW_VERSION
+
+    static constexpr uint8_t ROW_VERSION = 1;
+
     uint64_t primary_key() const {
         return sym_code.raw();
     }
 
-    EOSLIB_SERIALIZE(
+    // v1：仅增加 row_version
+    void upgrade_from(const uint8_t&) {}
+
+    TYCHE_ROW_SERIALIZE(
         reserve_state,
         (sym_code)(token_contract)
         (total_liquidity)(total_debt)(total_supply_shares)
@@ -187,6 +198,7 @@ NTBL("reserves") reserve_state {
         (max_ltv)(liquidation_threshold)(liquidation_bonus)(reserve_factor)
         (u_opt)(r0)(r_opt)(r_max)(max_rate_step_bp)
         (paused)
+        (row_version)
     )
 };
 using reserves_t = multi_index<"reserves"_n, reserve_state>;
@@ -201,10 +213,16 @@ NTBL("positions") position_row {
     borrow_interest_st      borrow;             // 借款状态（本金 + 利息）
     user_supply_interest_st supply_interest;    // 存款利息状态
     bool                    collateral = true;  // 是否计入抵押
+    binary_extension<uint8_t> row_version;      // 存储时的行版本，写入时总是 ROW_VERSION
+
+    static constexpr uint8_t ROW_VERSION = 1;
 
     uint64_t primary_key() const { return sym_code.raw(); }
 
-    EOSLIB_SERIALIZE(position_row,(sym_code)(supply_shares)(borrow)(supply_interest)(collateral))
+    // v1：仅增加 row_version
+    void upgrade_from(const uint8_t&) {}
+
+    TYCHE_ROW_SERIALIZE(position_row,(sym_code)(supply_shares)(borrow)(supply_interest)(collateral)(row_version))
 };
 using positions_t = multi_index<"positions"_n, position_row>;
 
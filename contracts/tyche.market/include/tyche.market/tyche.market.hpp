@@ -5,6 +5,8 @@
 #include <eosio/singleton.hpp>
 #include <string>
 
+#include <tyche.common/state_snapshot.hpp>
+
 #include "tyche.market.db.hpp"
 
 namespace tychefi {
@@ -19,11 +21,12 @@ public:
    tyche_market(name receiver, name code, datastream<const char*> ds)
    : contract(receiver, code, ds),
      _global(get_self(), get_self().value) {
-      _gstate = _global.exists() ? _global.get() : global_t{};
+      _gstate = load_state<global_singleton, global_t>(_global, _gstate_snapshot);
    }
 
    ~tyche_market() {
-      _global.set(_gstate, get_self());
+      //未变化的全局表不回写
+      save_state(_global, _gstate, _gstate_snapshot, get_self());
    }
    /// 初始化全局管理员（只允许合约自身 init）
    ACTION init(const name& admin);
@@ -64,6 +67,11 @@ public:
                      const uint64_t& r_opt,
                      const uint64_t& r_max);
 
+   /// 旧版本行写回为最新版本（admin）：owner 为空时处理 reserves，否则处理该用户的 positions
+   /// 从 start 开始最多 max_rows 行，返回下一批的 start，处理完返回空
+   [[eosio::action]]
+   symbol_code migraterows(const name& owner, const symbol_code& start, const uint32_t& max_rows);
+
    /// 提现本金（可能触发自动 claim 部分利息）
    ACTION withdraw(name owner, asset quantity);
 
@@ -95,6 +103,7 @@ public:
 private:
    global_singleton _global;
    global_t _gstate;
+   state_snapshot _gstate_snapshot;
 
    struct action_ctx {
     eosio::time_point_sec now;
@@ -283,20 +292,12 @@ private:
       check(dst >= v, err_msg);
       dst -= v;
    }
-   static inline int128_t pow10_i128(uint8_t p) {
-      int128_t r = 1;
-      for (uint8_t i = 0; i < p; ++i) r *= 10;
-      return r;
-   }
-
    // value_of: token amount -> USDT min-unit
    static inline int128_t value_of(const asset& amount, const asset& price_usdt) {
       // price_usdt: USDT symbol
       // result: USDT min-unit
       eosio::check(price_usdt.amount > 0, "invalid price");
-      int128_t num = (int128_t)amount.amount * (int128_t)price_usdt.amount;
-      int128_t den = pow10_i128(amount.symbol.precision());
-      return num / den;
+      return mul_div((int128_t)amount.amount, (int128_t)price_usdt.amount, pow10_i128(amount.symbol.precision()));
    }
 
    // HF Simulation Abstraction
@@ -1,10 +1,10 @@
 #include <tyche.market/tyche.market.hpp>
 
-#include <cmath>
 #include <limits>
 #include <tuple>
-#include "flon.token.hpp"
-#include "utils.hpp"
+#include <tyche.common/flon.token.hpp>
+#include <tyche.common/utils.hpp>
+#include <tyche.common/memo.hpp>
 
 namespace tychefi {
 
@@ -84,6 +84,7 @@ void tyche_market::addreserve(const extended_symbol& asset_sym,
     reserves_t reserves =  reserves_t(get_self(), get_self().value);
     auto pk = asset_sym.get_symbol().code().raw();
     CHECKC(reserves.find(pk) == reserves.end(), err::RECORD_EXISTING, "reserve exists");
+    CHECKC(std::distance(reserves.begin(), reserves.end()) < MAX_RESERVES, err::OVERSIZED, "too many reserves");
 
     reserves.emplace(get_self(), [&](auto& r){
         r.sym_code              = asset_sym.get_symbol().code();
@@ -105,7 +106,7 @@ void tyche_market::addreserve(const extended_symbol& asset_sym,
         r.r_max = r_max;
         r.max_rate_step_bp = 200;
 
-        r.borrow_index.index = HIGH_PRECISION;
+        r.borrow_index.index = wad::one;
         r.borrow_index.borrow_rate_bp = r0;
         r.borrow_index.last_updated = current_time_point();
     });
@@ -141,6 +142,21 @@ void tyche_market::setreserve(symbol_code sym, uint64_t max_ltv,uint64_t liq_thr
     });
 }
 
+symbol_code tyche_market::migraterows(const name& owner, const symbol_code& start, const uint32_t& max_rows) {
+    require_auth(_gstate.admin);
+    CHECKC(max_rows > 0, err::PARAM_ERROR, "max_rows must be positive");
+
+    std::optional<uint64_t> next;
+    if (owner.value == 0) {
+        reserves_t reserves(get_self(), get_self().value);
+        next = migrate_rows(reserves, start.raw(), max_rows);
+    } else {
+        auto positions = _positions(owner);
+        next = migrate_rows(positions, start.raw(), max_rows);
+    }
+    return next.has_value() ? symbol_code(*next) : symbol_code();
+}
+
 void tyche_market::borrow(name owner, asset quantity) {
     require_auth(owner);
     check(!_gstate.paused, "market paused");
@@ -353,17 +369,18 @@ void tyche_market::on_transfer(const name& from,const name& to,const asset& quan
     CHECKC(!_gstate.paused, err::PAUSED, "market paused");
     CHECKC(quantity.amount > 0, err::NOT_POSITIVE, "invalid amount");
 
-    auto parts = split(memo, ":");
+    memo_reader parts(memo, ':', (uint8_t)err::PARAM_ERROR);
+    auto type = parts.next();
     // -------- supply --------
-    if (parts[0] == "supply") {
+    if (type == "supply") {
         _on_supply(from, quantity);
         return;
     }
 
     // repay:<borrower>
-    if (parts[0] == "repay") {
-        CHECKC(parts.size() == 2, err::PARAM_ERROR, "invalid repay memo");
-        name borrower{ parts[1].c_str() };
+    if (type == "repay") {
+        name borrower = parts.next_name();
+        parts.end();
         check(is_account(borrower), "borrower not exists");
         _on_repay(from, borrower, quantity);
         return;
@@ -372,13 +389,12 @@ void tyche_market::on_transfer(const name& from,const name& to,const asset& quan
     // liquidate:<borrower>:<DEBT>:<COLL>
     // DEBT = 被偿还的债务资产（repay asset）
     // COLL = 被扣走的抵押资产（seize asset）
-    if (parts[0] == "liquidate") {
-        CHECKC(parts.size() == 4, err::PARAM_ERROR, "invalid liquidate memo");
-
-        name borrower{ parts[1].c_str() };
+    if (type == "liquidate") {
+        name borrower         = parts.next_name();
+        symbol_code debt_sym  = parts.next_symbol_code();
+        symbol_code coll_sym  = parts.next_symbol_code();
+        parts.end();
         check(is_account(borrower), "borrower not exists");
-        symbol_code debt_sym(parts[2]);
-        symbol_code coll_sym(parts[3]);
 
         _on_liquidate(from, borrower, debt_sym, quantity, coll_sym);
         return;
@@ -528,7 +544,8 @@ void tyche_market::_on_liquidate(const name& liquidator,const name& borrower,con
     _flush_reserve(ctx, reserves, debt_sym);
     _flush_reserve(ctx, reserves, coll_sym);
 
-    // 3) refund（多余的 debt token 退给清算人）
+    // 3) refund 与 seize 同一代币时合并为一笔转账
+    flon::transfer_batch payouts(get_self());
     if (lr.refund > 0) {
         check(repay_amount.symbol == debt_res.total_liquidity.symbol,"refund token must be debt token");
         check(repay_amount.symbol.code() == debt_sym,"repay symbol must match debt_sym");
@@ -600,7 +617,7 @@ liquidate_result tyche_market::_liquidate_internal(reserve_state& debt_res,
 
     // 5) USDT value -> collateral amount
     symbol coll_sym = coll_res.total_liquidity.symbol;
-    int128_t seize_amt = seize_value * pow10_i128(coll_sym.precision()) / (int128_t)coll_price.amount;
+    int128_t seize_amt = mul_div(seize_value, pow10_i128(coll_sym.precision()), (int128_t)coll_price.amount);
     check(seize_amt > 0, "seize too small");
     check(seize_amt <= (int128_t)std::numeric_limits<int64_t>::max(), "seize overflow");
 
@@ -650,7 +667,7 @@ void tyche_market::_settle_supply_interest(position_row& pos, const reserve_stat
 
     // === ④ 结算利息 ===
     if (delta_rps > 0 && pos.supply_shares.amount > 0) {
-        int128_t pending = delta_rps * (int128_t)pos.supply_shares.amount / HIGH_PRECISION;
+        int128_t pending = wad::from_raw(delta_rps).times((int128_t)pos.supply_shares.amount);
         if (pending > 0) {
             check(user.pending_interest.amount <= std::numeric_limits<int64_t>::max() - (int64_t)pending,"interest overflow");
             user.pending_interest.amount += (int64_t)pending;
@@ -699,7 +716,7 @@ void tyche_market::_settle_borrow_interest(const reserve_state& res,position_row
 
     // ⑤ 计算利息
     int128_t interest_i128 =
-        (int128_t)b.borrow_scaled * delta_index / HIGH_PRECISION;
+        wad::from_raw(delta_index).times((int128_t)b.borrow_scaled);
 
     if (interest_i128 > 0) {
         check(
@@ -789,13 +806,13 @@ void tyche_market::_accrue_borrow_index(reserve_state& res, time_point_sec now)
         return;
     }
 
-    int128_t delta = (int128_t)idx.index * idx.borrow_rate_bp * dt / (RATE_SCALE * SECONDS_PER_YEAR);
+    int128_t delta = mul_div((int128_t)idx.index, (int128_t)idx.borrow_rate_bp * dt, (int128_t)RATE_SCALE * SECONDS_PER_YEAR);
 
     if (delta > 0) {
         idx.index += (uint128_t)delta;
         idx.id += 1;   // 真实产生了利息
 
-        int128_t interest = res.total_borrow_scaled * delta / HIGH_PRECISION;
+        int128_t interest = wad::from_raw(delta).times((int128_t)res.total_borrow_scaled);
         res.total_accrued_interest += (int64_t)interest;
     }
 
@@ -830,7 +847,7 @@ void tyche_market::_accrue_supply_index(reserve_state& res, time_point_sec now)
     }
 
     // 计算本次 rps 增量
-    int128_t delta_rps = (int128_t)delta_available * HIGH_PRECISION / res.total_supply_shares.amount;
+    int128_t delta_rps = wad::from_ratio((int128_t)delta_available, res.total_supply_shares.amount).raw;
 
     if (delta_rps > 0) {
         sidx.reward_per_share += (uint128_t)delta_rps;
@@ -906,9 +923,7 @@ repay_result tyche_market::_repay_by_snapshot(reserve_state& res,position_row&
 
 uint64_t tyche_market::_util_bps(const reserve_state& res) const {
     int128_t debt =
-        (int128_t)res.total_borrow_scaled
-        * (int128_t)res.borrow_index.index
-        / (int128_t)HIGH_PRECISION
+        wad::from_raw((int128_t)res.borrow_index.index).times((int128_t)res.total_borrow_scaled)
         + (int128_t)res.total_accrued_interest;
 
     int128_t cash = (int128_t)res.total_liquidity.amount;
@@ -918,11 +933,11 @@ uint64_t tyche_market::_util_bps(const reserve_state& res) const {
 }
 
 int128_t tyche_market::_scaled_from_amount(int64_t amt, uint128_t idx) const {
-    return (int128_t)amt * HIGH_PRECISION / idx;
+    return wad::from_raw((int128_t)idx).divide((int128_t)amt);
 }
 
 int64_t tyche_market::_amount_from_scaled(int128_t scaled, uint128_t idx) const {
-    return (int64_t)(scaled * idx / HIGH_PRECISION);
+    return (int64_t)wad::from_raw((int128_t)idx).times(scaled);
 }
 
 tyche_market::valuation tyche_market::_compute_valuation(action_ctx& ctx,name owner,const position_row* override_pos,symbol_code override_sym) {
@@ -1019,7 +1034,7 @@ void tyche_market::_check_health_factor( action_ctx& ctx,name owner,const positi
 
 asset tyche_market::_get_fresh_price(prices_t& prices, symbol_code sym) const {
     if (sym == USDT_SYM.code()) {
-        return asset((int64_t)pow10(USDT_SYM.precision()), USDT_SYM);
+        return asset(pow10_i64(USDT_SYM.precision()), USDT_SYM);
     }
 
     auto itr = prices.find(sym.raw());
@@ -1054,10 +1069,7 @@ asset tyche_market::_withdraw_shares_from_amount(const asset& amount,const asset
     check(amount.symbol == total_amount.symbol, "symbol mismatch");
     check(total_amount.amount > 0 && total_shares.amount > 0, "invalid pool");
 
-    int128_t num = (int128_t)amount.amount * total_shares.amount;
-    int128_t den = total_amount.amount;
-
-    int64_t shares = (int64_t)((num + den - 1) / den); // ceil
+    int64_t shares = (int64_t)mul_div((int128_t)amount.amount, total_shares.amount, total_amount.amount, rounding::up);
     check(shares > 0, "withdraw too small");
 
     return asset(shares, amount.symbol);
@@ -1173,9 +1185,7 @@ int64_t tyche_market::_user_real_debt_amt(const reserve_state& res,const positio
 // 池子真实总债务（UI / 总览专用）
 int64_t tyche_market::_reserve_real_total_debt_amt(const reserve_state& res) const {
     int128_t debt =
-        (int128_t)res.total_borrow_scaled
-        * (int128_t)res.borrow_index.index
-        / (int128_t)HIGH_PRECISION
+        wad::from_raw((int128_t)res.borrow_index.index).times((int128_t)res.total_borrow_scaled)
         + (int128_t)res.total_accrued_interest;
     check(debt <= (int128_t)std::numeric_limits<int64_t>::max(), "overflow");
     return (int64_t)debt;
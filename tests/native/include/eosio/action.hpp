@@ -0,0 +1,126 @@
+#pragma once
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/runtime.hpp>
+#include <eosio/serialize.hpp>
+
+namespace eosio {
+
+struct permission_level {
+   permission_level(name a, name p) : actor(a), permission(p) {}
+   permission_level() {}
+
+   name actor;
+   name permission;
+
+   friend bool operator==(const permission_level& a, const permission_level& b) {
+      return a.actor == b.actor && a.permission == b.permission;
+   }
+
+   EOSLIB_SERIALIZE(permission_level, (actor)(permission))
+};
+
+inline bool has_auth(name n) { return native::state().auths.count(n.value) > 0; }
+
+inline void require_auth(name n) {
+   check(has_auth(n), "missing authority of " + n.to_string());
+}
+
+inline void require_auth(const permission_level& level) { require_auth(level.actor); }
+
+inline bool is_account(name n) {
+   auto& accts = native::state().accounts;
+   return accts.empty() || accts.count(n.value) > 0;
+}
+
+inline void require_recipient(name n) { native::state().notifications.push_back(n.value); }
+
+template <typename... Names>
+void require_recipient(name n, Names... ns) {
+   require_recipient(n);
+   require_recipient(ns...);
+}
+
+struct action {
+   eosio::name                   account;
+   eosio::name                   name;
+   std::vector<permission_level> authorization;
+   std::vector<char>             data;
+
+   action() = default;
+
+   template <typename T>
+   action(const std::vector<permission_level>& auth, eosio::name a, eosio::name n, T&& value)
+      : account(a), name(n), authorization(auth), data(pack(std::forward<T>(value))) {}
+
+   template <typename T>
+   action(const permission_level& auth, eosio::name a, eosio::name n, T&& value)
+      : account(a), name(n), authorization({auth}), data(pack(std::forward<T>(value))) {}
+
+   void send() const {
+      native::captured_action ca;
+      ca.account = account.value;
+      ca.name    = name.value;
+      for (const auto& p : authorization) ca.auth.emplace_back(p.actor.value, p.permission.value);
+      ca.data = data;
+      native::state().inline_actions.push_back(std::move(ca));
+   }
+
+   template <typename T>
+   T data_as() const { return unpack<T>(data); }
+};
+
+namespace detail {
+   template <typename T>
+   struct member_fn_traits;
+
+   template <typename C, typename R, typename... Args>
+   struct member_fn_traits<R (C::*)(Args...)> {
+      using args = std::tuple<std::decay_t<Args>...>;
+   };
+   template <typename C, typename R, typename... Args>
+   struct member_fn_traits<R (C::*)(Args...) const> {
+      using args = std::tuple<std::decay_t<Args>...>;
+   };
+}
+
+template <name::raw Name, auto Action>
+struct action_wrapper {
+   using args_t = typename detail::member_fn_traits<decltype(Action)>::args;
+
+   template <typename Code>
+   constexpr action_wrapper(Code&& code, std::vector<permission_level>&& perms)
+      : code_name(std::forward<Code>(code)), permissions(std::move(perms)) {}
+   template <typename Code>
+   constexpr action_wrapper(Code&& code, const std::vector<permission_level>& perms)
+      : code_name(std::forward<Code>(code)), permissions(perms) {}
+   template <typename Code>
+   constexpr action_wrapper(Code&& code, permission_level&& perm)
+      : code_name(std::forward<Code>(code)), permissions({1, std::move(perm)}) {}
+   template <typename Code>
+   constexpr action_wrapper(Code&& code, const permission_level& perm)
+      : code_name(std::forward<Code>(code)), permissions({1, perm}) {}
+
+   static constexpr eosio::name action_name = eosio::name(Name);
+   eosio::name                   code_name;
+   std::vector<permission_level> permissions;
+
+   template <typename... Args>
+   action to_action(Args&&... args) const {
+      static_assert(sizeof...(Args) == std::tuple_size<args_t>::value, "wrong number of arguments");
+      args_t t{std::forward<Args>(args)...};
+      return action(permissions, code_name, action_name, t);
+   }
+
+   template <typename... Args>
+   void send(Args&&... args) const { to_action(std::forward<Args>(args)...).send(); }
+};
+
+} // namespace eosio
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+
+#include <eosio/check.hpp>
+#include <eosio/symbol.hpp>
+
+namespace eosio {
+
+struct asset {
+   int64_t amount = 0;
+   eosio::symbol symbol;
+
+   static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+   asset() {}
+   asset(int64_t a, eosio::symbol s) : amount(a), symbol{s} {
+      check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+      check(symbol.is_valid(), "invalid symbol name");
+   }
+
+   bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+   bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+   void set_amount(int64_t a) {
+      amount = a;
+      check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+   }
+
+   asset operator-() const { asset r = *this; r.amount = -r.amount; return r; }
+
+   asset& operator-=(const asset& a) {
+      check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+      amount -= a.amount;
+      check(-max_amount <= amount, "subtraction underflow");
+      check(amount <= max_amount, "subtraction overflow");
+      return *this;
+   }
+   asset& operator+=(const asset& a) {
+      check(a.symbol == symbol, "attempt to add asset with different symbol");
+      amount += a.amount;
+      check(-max_amount <= amount, "addition underflow");
+      check(amount <= max_amount, "addition overflow");
+      return *this;
+   }
+   inline friend asset operator+(const asset& a, const asset& b) { asset r = a; r += b; return r; }
+   inline friend asset operator-(const asset& a, const asset& b) { asset r = a; r -= b; return r; }
+
+   asset& operator*=(int64_t a) {
+      __int128 tmp = (__int128)amount * (__int128)a;
+      check(tmp <= max_amount, "multiplication overflow");
+      check(tmp >= -max_amount, "multiplication underflow");
+      amount = (int64_t)tmp;
+      return *this;
+   }
+   friend asset operator*(const asset& a, int64_t b) { asset r = a; r *= b; return r; }
+   friend asset operator*(int64_t b, const asset& a) { asset r = a; r *= b; return r; }
+
+   asset& operator/=(int64_t a) {
+      check(a != 0, "divide by zero");
+      check(!(amount == std::numeric_limits<int64_t>::min() && a == -1), "signed division overflow");
+      amount /= a;
+      return *this;
+   }
+   friend asset operator/(const asset& a, int64_t b) { asset r = a; r /= b; return r; }
+   friend int64_t operator/(const asset& a, const asset& b) {
+      check(b.amount != 0, "divide by zero");
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount / b.amount;
+   }
+
+   friend bool operator==(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount == b.amount;
+   }
+   friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+   friend bool operator<(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount < b.amount;
+   }
+   friend bool operator<=(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount <= b.amount;
+   }
+   friend bool operator>(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount > b.amount;
+   }
+   friend bool operator>=(const asset& a, const asset& b) {
+      check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+      return a.amount >= b.amount;
+   }
+
+   std::string to_string() const {
+      bool negative = amount < 0;
+      uint64_t abs = negative ? (uint64_t)(-(__int128)amount) : (uint64_t)amount;
+      uint8_t p = symbol.precision();
+      uint64_t p10 = 1;
+      for (uint8_t i = 0; i < p; ++i) p10 *= 10;
+      std::string s = negative ? "-" : "";
+      s += std::to_string(abs / p10);
+      if (p > 0) {
+         std::string frac = std::to_string(abs % p10);
+         s += "." + std::string(p - frac.size(), '0') + frac;
+      }
+      return s + " " + symbol.code().to_string();
+   }
+};
+
+struct extended_asset {
+   asset quantity;
+   name  contract;
+
+   extended_asset() = default;
+   extended_asset(int64_t v, extended_symbol s) : quantity(v, s.get_symbol()), contract(s.get_contract()) {}
+   extended_asset(asset a, name c) : quantity(a), contract(c) {}
+
+   extended_symbol get_extended_symbol() const { return extended_symbol{quantity.symbol, contract}; }
+
+   std::string to_string() const { return quantity.to_string() + "@" + contract.to_string(); }
+
+   extended_asset& operator+=(const extended_asset& a) {
+      check(a.contract == contract, "type mismatch");
+      quantity += a.quantity;
+      return *this;
+   }
+   extended_asset& operator-=(const extended_asset& a) {
+      check(a.contract == contract, "type mismatch");
+      quantity -= a.quantity;
+      return *this;
+   }
+   friend extended_asset operator+(const extended_asset& a, const extended_asset& b) { auto r = a; r += b; return r; }
+   friend extended_asset operator-(const extended_asset& a, const extended_asset& b) { auto r = a; r -= b; return r; }
+   friend bool operator==(const extended_asset& a, const extended_asset& b) {
+      return std::tie(a.quantity, a.contract) == std::tie(b.quantity, b.contract);
+   }
+   friend bool operator!=(const extended_asset& a, const extended_asset& b) { return !(a == b); }
+   friend bool operator<(const extended_asset& a, const extended_asset& b) {
+      check(a.contract == b.contract, "type mismatch");
+      return a.quantity < b.quantity;
+   }
+};
+
+} // namespace eosio
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <optional>
+#include <utility>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+
+namespace eosio {
+
+// Trailing field that may be absent from older serialized data.
+template <typename T>
+class binary_extension {
+public:
+   using value_type = T;
+
+   constexpr binary_extension() {}
+   constexpr binary_extension(const T& ext) : _value(ext) {}
+   constexpr binary_extension(T&& ext) : _value(std::move(ext)) {}
+
+   constexpr bool has_value() const { return _value.has_value(); }
+   constexpr explicit operator bool() const { return has_value(); }
+
+   T& value() & { check(has_value(), "cannot get value of empty binary_extension"); return *_value; }
+   const T& value() const& { check(has_value(), "cannot get value of empty binary_extension"); return *_value; }
+   T value_or(const T& def = T()) const { return _value ? *_value : def; }
+
+   T& operator*() & { return value(); }
+   const T& operator*() const& { return value(); }
+   T* operator->() { return &value(); }
+   const T* operator->() const { return &value(); }
+
+   template <typename... Args>
+   T& emplace(Args&&... args) { _value.emplace(std::forward<Args>(args)...); return *_value; }
+   void reset() { _value.reset(); }
+
+private:
+   std::optional<T> _value;
+};
+
+template <typename DS, typename T>
+DS& operator<<(DS& ds, const binary_extension<T>& be) {
+   if (be.has_value()) ds << be.value();
+   return ds;
+}
+
+template <typename DS, typename T>
+DS& operator>>(DS& ds, binary_extension<T>& be) {
+   if (ds.remaining()) {
+      T val;
+      ds >> val;
+      be.emplace(std::move(val));
+   } else {
+      be.reset();
+   }
+   return ds;
+}
+
+} // namespace eosio
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <eosio/native/runtime.hpp>
+
+namespace eosio {
+
+inline void check(bool pred, const char* msg) {
+   if (!pred) throw native::assert_exception(msg);
+}
+
+inline void check(bool pred, const std::string& msg) {
+   if (!pred) throw native::assert_exception(msg);
+}
+
+inline void check(bool pred, std::string_view msg) {
+   if (!pred) throw native::assert_exception(std::string(msg));
+}
+
+inline void check(bool pred, const char* msg, size_t n) {
+   if (!pred) throw native::assert_exception(std::string(msg, n));
+}
+
+inline void check(bool pred, uint64_t code) {
+   if (!pred) throw native::assert_exception("error code: " + std::to_string(code));
+}
+
+} // namespace eosio
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include <eosio/fixed_bytes.hpp>
+
+namespace eosio {
+
+// Not a real SHA-256: a deterministic 256-bit FNV-style digest, enough for
+// contracts that only use the hash as a table key.
+inline checksum256 sha256(const char* data, uint32_t length) {
+   uint64_t h[4] = {0xcbf29ce484222325ull, 0x84222325cbf29ce4ull, 0x100000001b3ull, 0x9e3779b97f4a7c15ull};
+   for (uint32_t i = 0; i < length; ++i) {
+      for (int k = 0; k < 4; ++k) {
+         h[k] ^= (uint8_t)data[i] + k;
+         h[k] *= 0x100000001b3ull;
+      }
+   }
+   return checksum256::make_from_word_sequence<uint64_t>(h[0], h[1], h[2], h[3]);
+}
+
+} // namespace eosio
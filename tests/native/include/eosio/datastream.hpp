@@ -0,0 +1,360 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+template <typename T>
+class datastream {
+public:
+   datastream(T start, size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+   void skip(size_t s) { _pos += s; }
+   bool read(char* d, size_t s) {
+      check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+      std::memcpy(d, _pos, s);
+      _pos += s;
+      return true;
+   }
+   bool read(void* d, size_t s) { return read(static_cast<char*>(d), s); }
+   bool write(const char* d, size_t s) {
+      check(_end - _pos >= (int32_t)s, "datastream attempted to write past the end");
+      std::memcpy((void*)_pos, d, s);
+      _pos += s;
+      return true;
+   }
+   bool write(const void* d, size_t s) { return write(static_cast<const char*>(d), s); }
+   bool write(char d) { return write(&d, 1); }
+   bool get(char& c) { return read(&c, 1); }
+   bool get(unsigned char& c) { return read((char*)&c, 1); }
+
+   T pos() const { return _pos; }
+   bool valid() const { return _pos <= _end && _pos >= _start; }
+   bool seekp(size_t p) { _pos = _start + p; return _pos <= _end; }
+   size_t tellp() const { return size_t(_pos - _start); }
+   size_t remaining() const { return _end - _pos; }
+
+private:
+   T _start;
+   T _pos;
+   T _end;
+};
+
+template <>
+class datastream<size_t> {
+public:
+   datastream(size_t init_size = 0) : _size(init_size) {}
+   bool skip(size_t s) { _size += s; return true; }
+   bool write(const char*, size_t s) { _size += s; return true; }
+   bool write(const void*, size_t s) { _size += s; return true; }
+   bool write(char) { _size++; return true; }
+   bool valid() const { return true; }
+   bool seekp(size_t p) { _size = p; return true; }
+   size_t tellp() const { return _size; }
+   size_t remaining() const { return 0; }
+
+private:
+   size_t _size;
+};
+
+struct unsigned_int {
+   unsigned_int(uint32_t v = 0) : value(v) {}
+   operator uint32_t() const { return value; }
+   uint32_t value;
+};
+
+namespace detail {
+
+template <typename T>
+inline constexpr bool is_raw_v = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                                 std::is_same_v<T, __int128> || std::is_same_v<T, unsigned __int128>;
+
+struct any_field {
+   template <typename T>
+   operator T() const;
+};
+
+template <typename T, typename... A>
+constexpr auto brace_constructible(int) -> decltype(T{std::declval<A>()...}, std::true_type{});
+template <typename T, typename... A>
+constexpr std::false_type brace_constructible(...);
+
+template <typename T, size_t... I>
+constexpr bool constructible_with(std::index_sequence<I...>) {
+   return decltype(brace_constructible<T, decltype((void)I, any_field{})...>(0))::value;
+}
+
+template <typename T, size_t N = 32>
+constexpr size_t field_count() {
+   if constexpr (N == 0) return 0;
+   else if constexpr (constructible_with<T>(std::make_index_sequence<N>{})) return N;
+   else return field_count<T, N - 1>();
+}
+
+// Structured-binding walk used for plain aggregates that carry no
+// EOSLIB_SERIALIZE, mirroring CDT's reflection-based fallback.
+template <typename T, typename F>
+void for_each_field(T& t, F&& f) {
+   constexpr size_t N = field_count<std::remove_const_t<T>>();
+   if constexpr (N == 0) {}
+   else if constexpr (N == 1) { auto& [f0] = t; f(f0); }
+   else if constexpr (N == 2) { auto& [f0,f1] = t; f(f0,f1); }
+   else if constexpr (N == 3) { auto& [f0,f1,f2] = t; f(f0,f1,f2); }
+   else if constexpr (N == 4) { auto& [f0,f1,f2,f3] = t; f(f0,f1,f2,f3); }
+   else if constexpr (N == 5) { auto& [f0,f1,f2,f3,f4] = t; f(f0,f1,f2,f3,f4); }
+   else if constexpr (N == 6) { auto& [f0,f1,f2,f3,f4,f5] = t; f(f0,f1,f2,f3,f4,f5); }
+   else if constexpr (N == 7) { auto& [f0,f1,f2,f3,f4,f5,f6] = t; f(f0,f1,f2,f3,f4,f5,f6); }
+   else if constexpr (N == 8) { auto& [f0,f1,f2,f3,f4,f5,f6,f7] = t; f(f0,f1,f2,f3,f4,f5,f6,f7); }
+   else if constexpr (N == 9) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8); }
+   else if constexpr (N == 10) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9); }
+   else if constexpr (N == 11) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10); }
+   else if constexpr (N == 12) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11); }
+   else if constexpr (N == 13) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12); }
+   else if constexpr (N == 14) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13); }
+   else if constexpr (N == 15) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14); }
+   else if constexpr (N == 16) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15); }
+   else if constexpr (N == 17) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16); }
+   else if constexpr (N == 18) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17); }
+   else if constexpr (N == 19) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18); }
+   else if constexpr (N == 20) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19); }
+   else if constexpr (N == 21) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20); }
+   else if constexpr (N == 22) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21); }
+   else if constexpr (N == 23) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22); }
+   else if constexpr (N == 24) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23); }
+   else if constexpr (N == 25) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24); }
+   else if constexpr (N == 26) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25); }
+   else if constexpr (N == 27) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26); }
+   else if constexpr (N == 28) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27); }
+   else if constexpr (N == 29) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28); }
+   else if constexpr (N == 30) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28,f29] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28,f29); }
+   else if constexpr (N == 31) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28,f29,f30] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28,f29,f30); }
+   else if constexpr (N == 32) { auto& [f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28,f29,f30,f31] = t; f(f0,f1,f2,f3,f4,f5,f6,f7,f8,f9,f10,f11,f12,f13,f14,f15,f16,f17,f18,f19,f20,f21,f22,f23,f24,f25,f26,f27,f28,f29,f30,f31); }
+   else static_assert(N <= 32, "too many fields for aggregate reflection");
+}
+
+} // namespace detail
+
+// ---- primitives ----
+template <typename DS, typename T, std::enable_if_t<detail::is_raw_v<T>>* = nullptr>
+DS& operator<<(DS& ds, const T& v) {
+   if constexpr (std::is_same_v<T, bool>) { uint8_t b = v; ds.write((const char*)&b, 1); }
+   else ds.write((const char*)&v, sizeof(T));
+   return ds;
+}
+template <typename DS, typename T, std::enable_if_t<detail::is_raw_v<T>>* = nullptr>
+DS& operator>>(DS& ds, T& v) {
+   if constexpr (std::is_same_v<T, bool>) { uint8_t b = 0; ds.read((char*)&b, 1); v = b != 0; }
+   else ds.read((char*)&v, sizeof(T));
+   return ds;
+}
+
+template <typename DS>
+DS& operator<<(DS& ds, const unsigned_int& v) {
+   uint64_t val = v.value;
+   do {
+      uint8_t b = uint8_t(val) & 0x7f;
+      val >>= 7;
+      b |= ((val > 0) << 7);
+      ds.write((char*)&b, 1);
+   } while (val);
+   return ds;
+}
+template <typename DS>
+DS& operator>>(DS& ds, unsigned_int& vi) {
+   uint64_t v = 0; char b = 0; uint8_t by = 0;
+   do {
+      ds.get(b);
+      v |= uint32_t(uint8_t(b) & 0x7f) << by;
+      by += 7;
+   } while (uint8_t(b) & 0x80 && by < 32);
+   vi.value = static_cast<uint32_t>(v);
+   return ds;
+}
+
+template <typename DS>
+DS& operator<<(DS& ds, const std::string& v) {
+   ds << unsigned_int((uint32_t)v.size());
+   if (v.size()) ds.write(v.data(), v.size());
+   return ds;
+}
+template <typename DS>
+DS& operator>>(DS& ds, std::string& v) {
+   unsigned_int s; ds >> s;
+   v.resize(s.value);
+   if (s.value) ds.read(v.data(), s.value);
+   return ds;
+}
+
+// ---- chain types ----
+template <typename DS> DS& operator<<(DS& ds, const name& v) { return ds << v.value; }
+template <typename DS> DS& operator>>(DS& ds, name& v) { return ds >> v.value; }
+template <typename DS> DS& operator<<(DS& ds, const symbol_code& v) { return ds << v.raw(); }
+template <typename DS> DS& operator>>(DS& ds, symbol_code& v) { uint64_t r; ds >> r; v = symbol_code(r); return ds; }
+template <typename DS> DS& operator<<(DS& ds, const symbol& v) { return ds << v.raw(); }
+template <typename DS> DS& operator>>(DS& ds, symbol& v) { uint64_t r; ds >> r; v = symbol(r); return ds; }
+template <typename DS> DS& operator<<(DS& ds, const extended_symbol& v) { return ds << v.sym << v.contract; }
+template <typename DS> DS& operator>>(DS& ds, extended_symbol& v) { return ds >> v.sym >> v.contract; }
+template <typename DS> DS& operator<<(DS& ds, const asset& v) { return ds << v.amount << v.symbol; }
+template <typename DS> DS& operator>>(DS& ds, asset& v) { return ds >> v.amount >> v.symbol; }
+template <typename DS> DS& operator<<(DS& ds, const extended_asset& v) { return ds << v.quantity << v.contract; }
+template <typename DS> DS& operator>>(DS& ds, extended_asset& v) { return ds >> v.quantity >> v.contract; }
+template <typename DS> DS& operator<<(DS& ds, const microseconds& v) { return ds << v._count; }
+template <typename DS> DS& operator>>(DS& ds, microseconds& v) { return ds >> v._count; }
+template <typename DS> DS& operator<<(DS& ds, const time_point& v) { return ds << v.elapsed; }
+template <typename DS> DS& operator>>(DS& ds, time_point& v) { return ds >> v.elapsed; }
+template <typename DS> DS& operator<<(DS& ds, const time_point_sec& v) { return ds << v.utc_seconds; }
+template <typename DS> DS& operator>>(DS& ds, time_point_sec& v) { return ds >> v.utc_seconds; }
+template <typename DS> DS& operator<<(DS& ds, const block_timestamp& v) { return ds << v.slot; }
+template <typename DS> DS& operator>>(DS& ds, block_timestamp& v) { return ds >> v.slot; }
+template <typename DS, size_t N> DS& operator<<(DS& ds, const fixed_bytes<N>& v) { ds.write((const char*)v.data(), N); return ds; }
+template <typename DS, size_t N> DS& operator>>(DS& ds, fixed_bytes<N>& v) { ds.read((char*)v.data(), N); return ds; }
+
+// ---- containers ----
+template <typename DS, typename T>
+DS& operator<<(DS& ds, const std::vector<T>& v) {
+   ds << unsigned_int((uint32_t)v.size());
+   for (const auto& i : v) ds << i;
+   return ds;
+}
+template <typename DS, typename T>
+DS& operator>>(DS& ds, std::vector<T>& v) {
+   unsigned_int s; ds >> s;
+   v.clear(); v.resize(s.value);
+   for (auto& i : v) ds >> i;
+   return ds;
+}
+template <typename DS>
+DS& operator<<(DS& ds, const std::vector<char>& v) {
+   ds << unsigned_int((uint32_t)v.size());
+   if (v.size()) ds.write(v.data(), v.size());
+   return ds;
+}
+template <typename DS>
+DS& operator>>(DS& ds, std::vector<char>& v) {
+   unsigned_int s; ds >> s;
+   v.resize(s.value);
+   if (s.value) ds.read(v.data(), s.value);
+   return ds;
+}
+template <typename DS, typename T, size_t N>
+DS& operator<<(DS& ds, const std::array<T, N>& v) { for (const auto& i : v) ds << i; return ds; }
+template <typename DS, typename T, size_t N>
+DS& operator>>(DS& ds, std::array<T, N>& v) { for (auto& i : v) ds >> i; return ds; }
+
+template <typename DS, typename K, typename V, typename C>
+DS& operator<<(DS& ds, const std::map<K, V, C>& m) {
+   ds << unsigned_int((uint32_t)m.size());
+   for (const auto& kv : m) ds << kv.first << kv.second;
+   return ds;
+}
+template <typename DS, typename K, typename V, typename C>
+DS& operator>>(DS& ds, std::map<K, V, C>& m) {
+   m.clear();
+   unsigned_int s; ds >> s;
+   for (uint32_t i = 0; i < s.value; ++i) {
+      K k; V v;
+      ds >> k >> v;
+      m.emplace(std::move(k), std::move(v));
+   }
+   return ds;
+}
+template <typename DS, typename T, typename C>
+DS& operator<<(DS& ds, const std::set<T, C>& s) {
+   ds << unsigned_int((uint32_t)s.size());
+   for (const auto& i : s) ds << i;
+   return ds;
+}
+template <typename DS, typename T, typename C>
+DS& operator>>(DS& ds, std::set<T, C>& s) {
+   s.clear();
+   unsigned_int n; ds >> n;
+   for (uint32_t i = 0; i < n.value; ++i) { T v; ds >> v; s.emplace(std::move(v)); }
+   return ds;
+}
+template <typename DS, typename A, typename B>
+DS& operator<<(DS& ds, const std::pair<A, B>& p) { return ds << p.first << p.second; }
+template <typename DS, typename A, typename B>
+DS& operator>>(DS& ds, std::pair<A, B>& p) { return ds >> p.first >> p.second; }
+template <typename DS, typename T>
+DS& operator<<(DS& ds, const std::optional<T>& o) {
+   ds << bool(o.has_value());
+   if (o) ds << *o;
+   return ds;
+}
+template <typename DS, typename T>
+DS& operator>>(DS& ds, std::optional<T>& o) {
+   bool has = false; ds >> has;
+   if (has) { T v; ds >> v; o = std::move(v); } else o.reset();
+   return ds;
+}
+template <typename DS, typename... Ts>
+DS& operator<<(DS& ds, const std::tuple<Ts...>& t) {
+   std::apply([&](const auto&... e) { ((ds << e), ...); }, t);
+   return ds;
+}
+template <typename DS, typename... Ts>
+DS& operator>>(DS& ds, std::tuple<Ts...>& t) {
+   std::apply([&](auto&... e) { ((ds >> e), ...); }, t);
+   return ds;
+}
+
+// ---- plain aggregates (no EOSLIB_SERIALIZE) ----
+template <typename DS, typename T,
+          std::enable_if_t<std::is_class_v<T> && std::is_aggregate_v<T>>* = nullptr>
+DS& operator<<(DS& ds, const T& v) {
+   detail::for_each_field(v, [&](const auto&... f) { ((ds << f), ...); });
+   return ds;
+}
+template <typename DS, typename T,
+          std::enable_if_t<std::is_class_v<T> && std::is_aggregate_v<T>>* = nullptr>
+DS& operator>>(DS& ds, T& v) {
+   detail::for_each_field(v, [&](auto&... f) { ((ds >> f), ...); });
+   return ds;
+}
+
+// ---- helpers ----
+template <typename T>
+size_t pack_size(const T& v) {
+   datastream<size_t> ps;
+   ps << v;
+   return ps.tellp();
+}
+
+template <typename T>
+std::vector<char> pack(const T& v) {
+   std::vector<char> result(pack_size(v));
+   datastream<char*> ds(result.data(), result.size());
+   ds << v;
+   return result;
+}
+
+template <typename T>
+T unpack(const char* buffer, size_t len) {
+   T result{};
+   datastream<const char*> ds(buffer, len);
+   ds >> result;
+   return result;
+}
+
+template <typename T>
+T unpack(const std::vector<char>& bytes) { return unpack<T>(bytes.data(), bytes.size()); }
+
+} // namespace eosio
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace eosio {
+
+template <size_t Size>
+class fixed_bytes {
+public:
+   using word_t = unsigned __int128;
+   static constexpr size_t num_words() { return (Size + sizeof(word_t) - 1) / sizeof(word_t); }
+
+   fixed_bytes() : _data() {}
+   explicit fixed_bytes(const std::array<uint8_t, Size>& arr) { std::memcpy(_data.data(), arr.data(), Size); }
+
+   template <typename Word, typename... Rest>
+   static fixed_bytes<Size> make_from_word_sequence(Word first_word, Rest... rest) {
+      static_assert(std::is_integral<Word>::value && std::is_unsigned<Word>::value, "unsigned integral words only");
+      std::array<uint8_t, Size> arr{};
+      std::array<Word, 1 + sizeof...(Rest)> words{first_word, static_cast<Word>(rest)...};
+      size_t pos = 0;
+      for (auto w : words) {
+         for (int i = sizeof(Word) - 1; i >= 0 && pos < Size; --i) arr[pos++] = uint8_t(w >> (8 * i));
+      }
+      return fixed_bytes<Size>(arr);
+   }
+
+   std::array<uint8_t, Size> extract_as_byte_array() const {
+      std::array<uint8_t, Size> arr;
+      std::memcpy(arr.data(), _data.data(), Size);
+      return arr;
+   }
+
+   const uint8_t* data() const { return _data.data(); }
+   uint8_t* data() { return _data.data(); }
+   static constexpr size_t size() { return Size; }
+
+   friend bool operator==(const fixed_bytes& a, const fixed_bytes& b) { return a._data == b._data; }
+   friend bool operator!=(const fixed_bytes& a, const fixed_bytes& b) { return a._data != b._data; }
+   friend bool operator<(const fixed_bytes& a, const fixed_bytes& b)  { return a._data < b._data; }
+   friend bool operator>(const fixed_bytes& a, const fixed_bytes& b)  { return a._data > b._data; }
+   friend bool operator<=(const fixed_bytes& a, const fixed_bytes& b) { return a._data <= b._data; }
+   friend bool operator>=(const fixed_bytes& a, const fixed_bytes& b) { return a._data >= b._data; }
+
+private:
+   std::array<uint8_t, Size> _data;
+};
+
+using checksum160 = fixed_bytes<20>;
+using checksum256 = fixed_bytes<32>;
+using checksum512 = fixed_bytes<64>;
+
+} // namespace eosio
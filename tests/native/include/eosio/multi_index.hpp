@@ -0,0 +1,408 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/runtime.hpp>
+
+namespace eosio {
+
+static constexpr name same_payer{};
+
+template <name::raw IndexName, typename Extractor>
+struct indexed_by {
+   static constexpr name index_name = name(IndexName);
+   using secondary_extractor_type   = Extractor;
+};
+
+template <class Class, class Type, Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun {
+   using result_type = Type;
+   template <typename T>
+   Type operator()(const T& obj) const { return (obj.*PtrToMemberFunction)(); }
+};
+
+template <name::raw TableName, typename T, typename... Indices>
+class multi_index {
+   using rows_t = native::table_rows;
+
+public:
+   class const_iterator {
+   public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type        = const T;
+      using difference_type   = std::ptrdiff_t;
+      using pointer           = const T*;
+      using reference         = const T&;
+
+      const_iterator() = default;
+
+      const T& operator*() const {
+         check(_pk.has_value(), "cannot dereference end iterator");
+         return _mi->load(*_pk);
+      }
+      const T* operator->() const { return &**this; }
+
+      const_iterator& operator++() {
+         check(_pk.has_value(), "cannot increment end iterator");
+         auto& r = _mi->rows();
+         ++native::state().stats.next;
+         auto it = r.upper_bound(*_pk);
+         if (it == r.end()) _pk.reset();
+         else _pk = it->first;
+         return *this;
+      }
+      const_iterator operator++(int) { auto t = *this; ++*this; return t; }
+      const_iterator& operator--() {
+         auto& r = _mi->rows();
+         ++native::state().stats.next;
+         if (!_pk) {
+            check(!r.empty(), "cannot decrement end iterator when the table is empty");
+            _pk = r.rbegin()->first;
+         } else {
+            auto it = r.lower_bound(*_pk);
+            check(it != r.begin(), "cannot decrement iterator at beginning of table");
+            --it;
+            _pk = it->first;
+         }
+         return *this;
+      }
+      const_iterator operator--(int) { auto t = *this; --*this; return t; }
+
+      friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._pk == b._pk; }
+      friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._pk != b._pk; }
+
+   private:
+      friend class multi_index;
+      const_iterator(const multi_index* mi, std::optional<uint64_t> pk) : _mi(mi), _pk(pk) {}
+
+      const multi_index*      _mi = nullptr;
+      std::optional<uint64_t> _pk;
+   };
+   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+   template <typename IndexDef>
+   class index {
+      using extractor_t = typename IndexDef::secondary_extractor_type;
+
+   public:
+      using secondary_key_type = std::decay_t<decltype(extractor_t{}(std::declval<const T&>()))>;
+      using entry_t            = std::pair<secondary_key_type, uint64_t>;
+
+      class const_iterator {
+      public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type        = const T;
+         using difference_type   = std::ptrdiff_t;
+         using pointer           = const T*;
+         using reference         = const T&;
+
+         const_iterator() = default;
+
+         const T& operator*() const {
+            check(_e.has_value(), "cannot dereference end iterator");
+            return _idx->_mi->load(_e->second);
+         }
+         const T* operator->() const { return &**this; }
+
+         const_iterator& operator++() {
+            check(_e.has_value(), "cannot increment end iterator");
+            ++native::state().stats.idx;
+            auto all = _idx->entries();
+            auto it  = std::upper_bound(all.begin(), all.end(), *_e);
+            if (it == all.end()) _e.reset(); else _e = *it;
+            return *this;
+         }
+         const_iterator operator++(int) { auto t = *this; ++*this; return t; }
+         const_iterator& operator--() {
+            ++native::state().stats.idx;
+            auto all = _idx->entries();
+            if (!_e) {
+               check(!all.empty(), "cannot decrement end iterator when the index is empty");
+               _e = all.back();
+            } else {
+               auto it = std::lower_bound(all.begin(), all.end(), *_e);
+               check(it != all.begin(), "cannot decrement iterator at beginning of index");
+               _e = *--it;
+            }
+            return *this;
+         }
+         const_iterator operator--(int) { auto t = *this; --*this; return t; }
+
+         friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._e == b._e; }
+         friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._e != b._e; }
+
+      private:
+         friend class index;
+         const_iterator(const index* idx, std::optional<entry_t> e) : _idx(idx), _e(std::move(e)) {}
+
+         const index*           _idx = nullptr;
+         std::optional<entry_t> _e;
+      };
+      using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+      static constexpr eosio::name index_name() { return IndexDef::index_name; }
+
+      const_iterator begin() const {
+         ++native::state().stats.idx;
+         auto all = entries();
+         return all.empty() ? end() : const_iterator(this, all.front());
+      }
+      const_iterator cbegin() const { return begin(); }
+      const_iterator end() const { return const_iterator(this, std::nullopt); }
+      const_iterator cend() const { return end(); }
+      const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+      const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+      const_iterator lower_bound(const secondary_key_type& k) const {
+         ++native::state().stats.idx;
+         auto all = entries();
+         auto it  = std::lower_bound(all.begin(), all.end(), entry_t{k, 0},
+                                     [](const entry_t& a, const entry_t& b) { return a.first < b.first; });
+         return it == all.end() ? end() : const_iterator(this, *it);
+      }
+      const_iterator upper_bound(const secondary_key_type& k) const {
+         ++native::state().stats.idx;
+         auto all = entries();
+         auto it  = std::upper_bound(all.begin(), all.end(), entry_t{k, 0},
+                                     [](const entry_t& a, const entry_t& b) { return a.first < b.first; });
+         return it == all.end() ? end() : const_iterator(this, *it);
+      }
+      const_iterator find(const secondary_key_type& k) const {
+         auto it = lower_bound(k);
+         if (it == end() || !(it._e->first == k)) return end();
+         return it;
+      }
+      const_iterator require_find(const secondary_key_type& k, const char* msg = "unable to find secondary key") const {
+         auto it = find(k);
+         check(it != end(), msg);
+         return it;
+      }
+      const T& get(const secondary_key_type& k, const char* msg = "unable to find secondary key") const {
+         return *require_find(k, msg);
+      }
+      const_iterator iterator_to(const T& obj) const {
+         return const_iterator(this, entry_t{extractor_t{}(obj), obj.primary_key()});
+      }
+
+      template <typename Lambda>
+      void modify(const_iterator itr, eosio::name payer, Lambda&& updater) {
+         _mi->modify(_mi->find(itr._e->second), payer, std::forward<Lambda>(updater));
+      }
+      const_iterator erase(const_iterator itr) {
+         auto next = itr;
+         ++next;
+         _mi->erase(_mi->find(itr._e->second));
+         return next;
+      }
+
+      eosio::name get_code() const { return _mi->get_code(); }
+      uint64_t get_scope() const { return _mi->get_scope(); }
+
+   private:
+      friend class multi_index;
+      explicit index(multi_index* mi) : _mi(mi) {}
+
+      std::vector<entry_t> entries() const {
+         std::vector<entry_t> out;
+         for (const auto& [pk, row] : _mi->rows()) {
+            out.emplace_back(extractor_t{}(unpack<T>(row.data)), pk);
+         }
+         std::sort(out.begin(), out.end());
+         return out;
+      }
+
+      multi_index* _mi;
+   };
+
+   multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+   multi_index(const multi_index&) = delete;
+   multi_index& operator=(const multi_index&) = delete;
+   multi_index(multi_index&&) = default;
+   multi_index& operator=(multi_index&&) = default;
+
+   name get_code() const { return _code; }
+   uint64_t get_scope() const { return _scope; }
+
+   const_iterator cbegin() const { return begin(); }
+   const_iterator begin() const { return lower_bound(std::numeric_limits<uint64_t>::lowest()); }
+   const_iterator cend() const { return end(); }
+   const_iterator end() const { return const_iterator(this, std::nullopt); }
+   const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+   const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+   const_iterator lower_bound(uint64_t pk) const {
+      ++native::state().stats.find;
+      auto& r  = rows();
+      auto  it = r.lower_bound(pk);
+      return it == r.end() ? end() : const_iterator(this, it->first);
+   }
+   const_iterator upper_bound(uint64_t pk) const {
+      ++native::state().stats.find;
+      auto& r  = rows();
+      auto  it = r.upper_bound(pk);
+      return it == r.end() ? end() : const_iterator(this, it->first);
+   }
+
+   uint64_t available_primary_key() const {
+      auto& r = rows();
+      return r.empty() ? 0 : r.rbegin()->first + 1;
+   }
+
+   template <name::raw IndexName>
+   auto get_index() const {
+      using def = find_index_t<IndexName, Indices...>;
+      static_assert(!std::is_void_v<def>, "name provided is not the name of any secondary index within multi_index");
+      return index<def>(const_cast<multi_index*>(this));
+   }
+
+   const_iterator iterator_to(const T& obj) const { return const_iterator(this, obj.primary_key()); }
+
+   template <typename Lambda>
+   const_iterator emplace(name payer, Lambda&& constructor) {
+      check(_code == name(native::state().receiver) || native::state().receiver == 0,
+            "cannot create objects in table of another contract");
+      auto obj = std::make_unique<T>();
+      constructor(*obj);
+      const uint64_t pk = obj->primary_key();
+      auto& r = rows();
+      check(r.find(pk) == r.end(), "could not insert object, most likely a uniqueness constraint was violated");
+
+      native::stored_row row{payer.value, pack(*obj)};
+      native::bill(payer.value, (int64_t)row.data.size() + native::row_overhead_bytes);
+      r.emplace(pk, std::move(row));
+      auto& st = native::state().stats;
+      ++st.store;
+      st.idx += sizeof...(Indices);
+
+      _cache[pk] = std::move(obj);
+      return const_iterator(this, pk);
+   }
+
+   template <typename Lambda>
+   void modify(const_iterator itr, name payer, Lambda&& updater) {
+      check(itr != end(), "cannot pass end iterator to modify");
+      modify(*itr, payer, std::forward<Lambda>(updater));
+   }
+
+   template <typename Lambda>
+   void modify(const T& obj, name payer, Lambda&& updater) {
+      const uint64_t pk = obj.primary_key();
+      auto& r  = rows();
+      auto  rt = r.find(pk);
+      check(rt != r.end(), "object passed to modify is not in multi_index");
+      T& mutable_obj = const_cast<T&>(load(pk));
+      auto before = secondary_keys(mutable_obj);
+      updater(mutable_obj);
+      check(pk == mutable_obj.primary_key(), "updater cannot change primary key when modifying an object");
+
+      auto data     = pack(mutable_obj);
+      auto old_size = (int64_t)rt->second.data.size();
+      uint64_t new_payer = payer.value == 0 ? rt->second.payer : payer.value;
+      native::bill(rt->second.payer, -(old_size + native::row_overhead_bytes));
+      native::bill(new_payer, (int64_t)data.size() + native::row_overhead_bytes);
+      rt->second.payer = new_payer;
+      rt->second.data  = std::move(data);
+
+      auto& st = native::state().stats;
+      ++st.update;
+      st.idx += count_changed(before, secondary_keys(mutable_obj));
+   }
+
+   const T& get(uint64_t pk, const char* msg = "unable to find key") const {
+      auto it = find(pk);
+      check(it != end(), msg);
+      return *it;
+   }
+
+   const_iterator find(uint64_t pk) const {
+      if (_cache.count(pk) && rows().count(pk)) return const_iterator(this, pk);
+      auto& st = native::state().stats;
+      ++st.find;
+      if (!rows().count(pk)) return end();
+      return const_iterator(this, pk);
+   }
+
+   const_iterator require_find(uint64_t pk, const char* msg = "unable to find key") const {
+      auto it = find(pk);
+      check(it != end(), msg);
+      return it;
+   }
+
+   const_iterator erase(const_iterator itr) {
+      check(itr != end(), "cannot pass end iterator to erase");
+      auto next = itr;
+      ++next;
+      erase(*itr);
+      return next;
+   }
+
+   void erase(const T& obj) {
+      const uint64_t pk = obj.primary_key();
+      auto& r  = rows();
+      auto  rt = r.find(pk);
+      check(rt != r.end(), "object passed to erase is not in multi_index");
+      native::bill(rt->second.payer, -((int64_t)rt->second.data.size() + native::row_overhead_bytes));
+      r.erase(rt);
+      _cache.erase(pk);
+      auto& st = native::state().stats;
+      ++st.remove;
+      st.idx += sizeof...(Indices);
+   }
+
+private:
+   template <name::raw N, typename... Is>
+   struct find_index { using type = void; };
+   template <name::raw N, typename I, typename... Is>
+   struct find_index<N, I, Is...> {
+      using type = std::conditional_t<I::index_name == name(N), I, typename find_index<N, Is...>::type>;
+   };
+   template <name::raw N, typename... Is>
+   using find_index_t = typename find_index<N, Is...>::type;
+
+   rows_t& rows() const { return native::rows(_code.value, _scope, static_cast<uint64_t>(TableName)); }
+
+   const T& load(uint64_t pk) const {
+      auto c = _cache.find(pk);
+      if (c != _cache.end()) return *c->second;
+      auto& r  = rows();
+      auto  rt = r.find(pk);
+      check(rt != r.end(), "unable to find key");
+      ++native::state().stats.get;
+      ++native::state().loads[{_code.value, _scope, static_cast<uint64_t>(TableName), pk}];
+      auto obj = std::make_unique<T>(unpack<T>(rt->second.data));
+      auto& ref = *obj;
+      _cache[pk] = std::move(obj);
+      return ref;
+   }
+
+   static auto secondary_keys(const T& obj) {
+      return std::make_tuple(typename Indices::secondary_extractor_type{}(obj)...);
+   }
+   template <typename Tuple>
+   static uint64_t count_changed(const Tuple& a, const Tuple& b) {
+      uint64_t n = 0;
+      std::apply([&](const auto&... x) {
+         std::apply([&](const auto&... y) { ((n += (x == y) ? 0 : 1), ...); }, b);
+      }, a);
+      return n;
+   }
+
+   name                                               _code;
+   uint64_t                                           _scope;
+   mutable std::map<uint64_t, std::unique_ptr<T>>     _cache;
+};
+
+} // namespace eosio
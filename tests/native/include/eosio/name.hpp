@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <eosio/check.hpp>
+
+namespace eosio {
+
+struct name {
+   enum class raw : uint64_t {};
+
+   uint64_t value = 0;
+
+   constexpr name() = default;
+   constexpr explicit name(uint64_t v) : value(v) {}
+   constexpr explicit name(name::raw r) : value(static_cast<uint64_t>(r)) {}
+   constexpr explicit name(std::string_view str) : value(0) {
+      if (str.size() > 13) throw native::assert_exception("string is too long to be a valid name");
+      if (str.empty()) return;
+      auto n = std::min<size_t>(str.size(), 12);
+      for (size_t i = 0; i < n; ++i) {
+         value <<= 5;
+         value |= char_to_value(str[i]);
+      }
+      value <<= (4 + 5 * (12 - n));
+      if (str.size() == 13) {
+         uint64_t v = char_to_value(str[12]);
+         if (v > 0x0Full) throw native::assert_exception("thirteenth character in name cannot be a letter that comes after j");
+         value |= v;
+      }
+   }
+
+   static constexpr uint8_t char_to_value(char c) {
+      if (c == '.') return 0;
+      if (c >= '1' && c <= '5') return (c - '1') + 1;
+      if (c >= 'a' && c <= 'z') return (c - 'a') + 6;
+      throw native::assert_exception("character is not in allowed character set for names");
+   }
+
+   constexpr operator raw() const { return raw(value); }
+   constexpr explicit operator bool() const { return value != 0; }
+
+   std::string to_string() const {
+      static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+      std::string str(13, '.');
+      uint64_t tmp = value;
+      for (uint32_t i = 0; i <= 12; ++i) {
+         char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+         str[12 - i] = c;
+         tmp >>= (i == 0 ? 4 : 5);
+      }
+      auto end = str.find_last_not_of('.');
+      str.resize(end == std::string::npos ? 0 : end + 1);
+      return str;
+   }
+
+   constexpr friend bool operator==(const name& a, const name& b) { return a.value == b.value; }
+   constexpr friend bool operator!=(const name& a, const name& b) { return a.value != b.value; }
+   constexpr friend bool operator<(const name& a, const name& b)  { return a.value < b.value; }
+   constexpr friend bool operator>(const name& a, const name& b)  { return a.value > b.value; }
+   constexpr friend bool operator<=(const name& a, const name& b) { return a.value <= b.value; }
+   constexpr friend bool operator>=(const name& a, const name& b) { return a.value >= b.value; }
+};
+
+namespace detail {
+   template <char... Str>
+   struct to_const_char_arr {
+      static constexpr const char value[] = {Str...};
+   };
+}
+
+} // namespace eosio
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+template <typename T, T... Str>
+inline constexpr eosio::name operator""_n() {
+   constexpr auto x = eosio::name{std::string_view{eosio::detail::to_const_char_arr<Str...>::value, sizeof...(Str)}};
+   return x;
+}
+#pragma GCC diagnostic pop
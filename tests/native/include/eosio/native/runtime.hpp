@@ -0,0 +1,118 @@
+#pragma once
+
+// In-memory chain state backing the host-native eosio emulation.
+// Everything a contract would reach through intrinsics lives here so that
+// tests can seed, inspect and reset it between cases.
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using int128_t  = __int128;
+using uint128_t = unsigned __int128;
+
+namespace eosio { namespace native {
+
+struct assert_exception : std::runtime_error {
+   using std::runtime_error::runtime_error;
+};
+
+// raw counters of the db intrinsics a wasm build would have executed
+struct db_stats {
+   uint64_t find    = 0;   // db_find_i64 / db_lowerbound_i64 / db_end_i64
+   uint64_t get     = 0;   // db_get_i64 (row fetch + deserialization)
+   uint64_t next    = 0;   // db_next_i64 / db_previous_i64
+   uint64_t store   = 0;   // db_store_i64
+   uint64_t update  = 0;   // db_update_i64
+   uint64_t remove  = 0;   // db_remove_i64
+   uint64_t idx     = 0;   // db_idx*_*
+
+   uint64_t reads()  const { return find + get + next + idx; }
+   uint64_t writes() const { return store + update + remove; }
+   uint64_t total()  const { return reads() + writes(); }
+};
+
+struct captured_action {
+   uint64_t                                   account = 0;
+   uint64_t                                   name    = 0;
+   std::vector<std::pair<uint64_t, uint64_t>> auth;          // actor, permission
+   std::vector<char>                          data;
+};
+
+struct table_key {
+   uint64_t code, scope, table;
+   bool operator<(const table_key& o) const {
+      return std::tie(code, scope, table) < std::tie(o.code, o.scope, o.table);
+   }
+};
+
+struct stored_row {
+   uint64_t          payer = 0;
+   std::vector<char> data;
+};
+
+using table_rows = std::map<uint64_t, stored_row>;
+
+// RAM billed per row on chain on top of the serialized bytes
+static constexpr int64_t row_overhead_bytes = 112;
+
+struct chain_state {
+   std::map<table_key, table_rows>  tables;
+   std::map<uint64_t, int64_t>      ram_usage;      // payer -> bytes
+   std::set<uint64_t>               auths;          // accounts that signed the current action
+   std::set<uint64_t>               accounts;       // known accounts, empty == all exist
+   std::vector<captured_action>     inline_actions;
+   std::vector<uint64_t>            notifications;
+   std::vector<std::string>         console;
+   db_stats                         stats;
+   std::map<std::tuple<uint64_t,uint64_t,uint64_t,uint64_t>, int> loads;   // row deserializations this action
+   int64_t                          now_us   = 1'700'000'000LL * 1'000'000LL;
+   uint64_t                         receiver = 0;
+   uint64_t                         first_receiver = 0;
+};
+
+inline chain_state& state() {
+   static chain_state s;
+   return s;
+}
+
+inline void reset() { state() = chain_state{}; }
+
+// Clears per-action side effects while keeping tables, clock and accounts.
+inline void begin_action() {
+   auto& s = state();
+   s.inline_actions.clear();
+   s.notifications.clear();
+   s.console.clear();
+   s.stats = db_stats{};
+   s.loads.clear();
+}
+
+// Tables and RAM before an action. Restored when the action aborts, the way
+// a failed transaction leaves none of its writes behind.
+struct checkpoint {
+   std::map<table_key, table_rows> tables;
+   std::map<uint64_t, int64_t>     ram_usage;
+};
+
+inline checkpoint save_checkpoint() { return checkpoint{state().tables, state().ram_usage}; }
+
+inline void restore_checkpoint(checkpoint&& c) {
+   state().tables    = std::move(c.tables);
+   state().ram_usage = std::move(c.ram_usage);
+}
+
+inline table_rows& rows(uint64_t code, uint64_t scope, uint64_t table) {
+   return state().tables[table_key{code, scope, table}];
+}
+
+inline void bill(uint64_t payer, int64_t delta) {
+   state().ram_usage[payer] += delta;
+}
+
+}} // namespace eosio::native
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+#include <eosio/native/runtime.hpp>
+#include <eosio/symbol.hpp>
+
+namespace eosio {
+
+namespace detail {
+   //eosio 命名空间内的 operator<< 是 datastream 序列化, 这里只用 std::string 拼接
+   template <typename T>
+   void print_one(std::string& out, const T& v) {
+      using U = std::decay_t<T>;
+      if constexpr (std::is_same_v<U, bool>) out += (v ? "true" : "false");
+      else if constexpr (std::is_same_v<U, char>) out += v;
+      else if constexpr (std::is_same_v<U, __int128>) out += std::to_string((long long)v);
+      else if constexpr (std::is_same_v<U, unsigned __int128>) out += std::to_string((unsigned long long)v);
+      else if constexpr (std::is_integral_v<U> || std::is_floating_point_v<U>) out += std::to_string(v);
+      else if constexpr (std::is_convertible_v<const T&, std::string_view>) out += std::string_view(v);
+      else out += v.to_string();
+   }
+}
+
+template <typename... Args>
+void print(Args&&... args) {
+   std::string out;
+   (detail::print_one(out, args), ...);
+   native::state().console.push_back(out);
+}
+
+template <typename... Args>
+void print_f(const char* fmt, Args&&... args) { print(fmt, args...); }
+
+} // namespace eosio
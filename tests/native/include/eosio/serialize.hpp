@@ -0,0 +1,40 @@
+#pragma once
+
+#include <eosio/datastream.hpp>
+
+// Walks a BOOST_PP-style member sequence `(a)(b)(c)` without Boost: the two
+// macros hand the sequence back and forth and the trailing name is pasted
+// into an empty terminator.
+#define EOSIO_NATIVE_CAT(a, b) EOSIO_NATIVE_CAT_I(a, b)
+#define EOSIO_NATIVE_CAT_I(a, b) a##b
+
+#define EOSIO_NATIVE_OUT_A(m) << t.m EOSIO_NATIVE_OUT_B
+#define EOSIO_NATIVE_OUT_B(m) << t.m EOSIO_NATIVE_OUT_A
+#define EOSIO_NATIVE_OUT_A_END
+#define EOSIO_NATIVE_OUT_B_END
+#define EOSIO_NATIVE_IN_A(m) >> t.m EOSIO_NATIVE_IN_B
+#define EOSIO_NATIVE_IN_B(m) >> t.m EOSIO_NATIVE_IN_A
+#define EOSIO_NATIVE_IN_A_END
+#define EOSIO_NATIVE_IN_B_END
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS)                                             \
+   template <typename DataStream>                                                   \
+   friend DataStream& operator<<(DataStream& ds, const TYPE& t) {                   \
+      return ds EOSIO_NATIVE_CAT(EOSIO_NATIVE_OUT_A MEMBERS, _END);                  \
+   }                                                                                \
+   template <typename DataStream>                                                   \
+   friend DataStream& operator>>(DataStream& ds, TYPE& t) {                         \
+      return ds EOSIO_NATIVE_CAT(EOSIO_NATIVE_IN_A MEMBERS, _END);                   \
+   }
+
+#define EOSLIB_SERIALIZE_DERIVED(TYPE, BASE, MEMBERS)                               \
+   template <typename DataStream>                                                   \
+   friend DataStream& operator<<(DataStream& ds, const TYPE& t) {                   \
+      ds << static_cast<const BASE&>(t);                                            \
+      return ds EOSIO_NATIVE_CAT(EOSIO_NATIVE_OUT_A MEMBERS, _END);                  \
+   }                                                                                \
+   template <typename DataStream>                                                   \
+   friend DataStream& operator>>(DataStream& ds, TYPE& t) {                         \
+      ds >> static_cast<BASE&>(t);                                                  \
+      return ds EOSIO_NATIVE_CAT(EOSIO_NATIVE_IN_A MEMBERS, _END);                   \
+   }
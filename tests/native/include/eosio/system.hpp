@@ -0,0 +1,10 @@
+#pragma once
+
+#include <eosio/time.hpp>
+
+namespace eosio {
+
+inline uint32_t tapos_block_num() { return 0; }
+inline uint32_t tapos_block_prefix() { return 0; }
+
+} // namespace eosio
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <eosio/check.hpp>
+
+namespace eosio {
+
+class microseconds {
+public:
+   microseconds() : _count(0) {}
+   explicit microseconds(int64_t c) : _count(c) {}
+
+   static microseconds maximum() { return microseconds(0x7fffffffffffffffll); }
+   friend microseconds operator+(const microseconds& l, const microseconds& r) { return microseconds(l._count + r._count); }
+   friend microseconds operator-(const microseconds& l, const microseconds& r) { return microseconds(l._count - r._count); }
+
+   bool operator==(const microseconds& c) const { return _count == c._count; }
+   bool operator!=(const microseconds& c) const { return _count != c._count; }
+   friend bool operator>(const microseconds& a, const microseconds& b)  { return a._count > b._count; }
+   friend bool operator>=(const microseconds& a, const microseconds& b) { return a._count >= b._count; }
+   friend bool operator<(const microseconds& a, const microseconds& b)  { return a._count < b._count; }
+   friend bool operator<=(const microseconds& a, const microseconds& b) { return a._count <= b._count; }
+   microseconds& operator+=(const microseconds& c) { _count += c._count; return *this; }
+   microseconds& operator-=(const microseconds& c) { _count -= c._count; return *this; }
+   int64_t count() const { return _count; }
+   int64_t to_seconds() const { return _count / 1000000; }
+
+   int64_t _count;
+};
+
+inline microseconds seconds(int64_t s) { return microseconds(s * 1000000); }
+inline microseconds milliseconds(int64_t s) { return microseconds(s * 1000); }
+inline microseconds minutes(int64_t m) { return seconds(60 * m); }
+inline microseconds hours(int64_t h) { return minutes(60 * h); }
+inline microseconds days(int64_t d) { return hours(24 * d); }
+
+class time_point {
+public:
+   time_point() {}
+   explicit time_point(microseconds e) : elapsed(e) {}
+   const microseconds& time_since_epoch() const { return elapsed; }
+   uint32_t sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+
+   bool operator>(const time_point& t) const  { return elapsed._count > t.elapsed._count; }
+   bool operator>=(const time_point& t) const { return elapsed._count >= t.elapsed._count; }
+   bool operator<(const time_point& t) const  { return elapsed._count < t.elapsed._count; }
+   bool operator<=(const time_point& t) const { return elapsed._count <= t.elapsed._count; }
+   bool operator==(const time_point& t) const { return elapsed._count == t.elapsed._count; }
+   bool operator!=(const time_point& t) const { return elapsed._count != t.elapsed._count; }
+   time_point& operator+=(const microseconds& m) { elapsed += m; return *this; }
+   time_point& operator-=(const microseconds& m) { elapsed -= m; return *this; }
+   time_point operator+(const microseconds& m) const { return time_point(elapsed + m); }
+   time_point operator+(const time_point& m) const { return time_point(elapsed + m.elapsed); }
+   time_point operator-(const microseconds& m) const { return time_point(elapsed - m); }
+   microseconds operator-(const time_point& m) const { return microseconds(elapsed.count() - m.elapsed.count()); }
+
+   microseconds elapsed;
+};
+
+class time_point_sec {
+public:
+   time_point_sec() : utc_seconds(0) {}
+   explicit time_point_sec(uint32_t seconds) : utc_seconds(seconds) {}
+   time_point_sec(const time_point& t) : utc_seconds(uint32_t(t.time_since_epoch().count() / 1000000ll)) {}
+
+   static time_point_sec maximum() { return time_point_sec(0xffffffff); }
+   static time_point_sec min() { return time_point_sec(0); }
+
+   operator time_point() const { return time_point(eosio::seconds(utc_seconds)); }
+   uint32_t sec_since_epoch() const { return utc_seconds; }
+
+   time_point_sec operator=(const eosio::time_point& t) {
+      utc_seconds = uint32_t(t.time_since_epoch().count() / 1000000ll);
+      return *this;
+   }
+   friend bool operator<(const time_point_sec& a, const time_point_sec& b)  { return a.utc_seconds < b.utc_seconds; }
+   friend bool operator>(const time_point_sec& a, const time_point_sec& b)  { return a.utc_seconds > b.utc_seconds; }
+   friend bool operator<=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds <= b.utc_seconds; }
+   friend bool operator>=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds >= b.utc_seconds; }
+   friend bool operator==(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds == b.utc_seconds; }
+   friend bool operator!=(const time_point_sec& a, const time_point_sec& b) { return a.utc_seconds != b.utc_seconds; }
+   time_point_sec& operator+=(uint32_t m) { utc_seconds += m; return *this; }
+   time_point_sec& operator+=(microseconds m) { utc_seconds += m.to_seconds(); return *this; }
+   time_point_sec& operator-=(uint32_t m) { utc_seconds -= m; return *this; }
+   time_point_sec& operator-=(microseconds m) { utc_seconds -= m.to_seconds(); return *this; }
+   time_point_sec operator+(uint32_t offset) const { return time_point_sec(utc_seconds + offset); }
+   time_point_sec operator-(uint32_t offset) const { return time_point_sec(utc_seconds - offset); }
+
+   friend time_point operator+(const time_point_sec& t, const microseconds& m) { return time_point(t) + m; }
+   friend time_point operator-(const time_point_sec& t, const microseconds& m) { return time_point(t) - m; }
+   friend microseconds operator-(const time_point_sec& t, const time_point_sec& m) { return time_point(t) - time_point(m); }
+   friend microseconds operator-(const time_point& t, const time_point_sec& m) { return time_point(t) - time_point(m); }
+
+   uint32_t utc_seconds;
+};
+
+inline time_point current_time_point() { return time_point(microseconds(native::state().now_us)); }
+inline time_point_sec current_time_point_sec() { return time_point_sec(current_time_point()); }
+
+class block_timestamp {
+public:
+   explicit block_timestamp(uint32_t s = 0) : slot(s) {}
+   uint32_t slot;
+};
+
+} // namespace eosio
@@ -0,0 +1,214 @@
+#pragma once
+
+// Minimal test harness for contracts built against the in-memory chain
+// emulator in include/eosio. A test pushes actions through tester<Contract>,
+// which plays the part of the node: it sets the signers, receiver and clock,
+// runs one action on a fresh contract object, captures inline actions and
+// db counters, and rolls the tables back when the action aborts.
+//
+// Every test prints the db intrinsics it executed, so a change to a hot path
+// shows up as a deterministic counter diff without a node.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <eosio/eosio.hpp>
+
+namespace tychefi { namespace native_test {
+
+using eosio::name;
+namespace native = eosio::native;
+
+struct failure : std::runtime_error {
+   using std::runtime_error::runtime_error;
+};
+
+struct action_result {
+   bool                                  ok = true;
+   std::string                           error;          // check() message when !ok
+   std::vector<native::captured_action>  inline_actions;
+   std::vector<uint64_t>                 notifications;
+   std::vector<std::string>              console;
+   native::db_stats                      stats;
+   std::map<std::tuple<uint64_t,uint64_t,uint64_t,uint64_t>, int> loads;   // (code, scope, table, pk) -> row fetches
+
+   // most times any single row was fetched and deserialized by the action
+   int max_row_loads() const {
+      int n = 0;
+      for (const auto& kv : loads) n = std::max(n, kv.second);
+      return n;
+   }
+};
+
+// db counters of all actions pushed by the running test
+inline native::db_stats& test_stats() {
+   static native::db_stats s;
+   return s;
+}
+
+inline void accumulate(native::db_stats& to, const native::db_stats& from) {
+   to.find   += from.find;
+   to.get    += from.get;
+   to.next   += from.next;
+   to.store  += from.store;
+   to.update += from.update;
+   to.remove += from.remove;
+   to.idx    += from.idx;
+}
+
+template <typename Contract>
+class tester {
+public:
+   explicit tester(name self) : _self(self) { native::reset(); }
+
+   name self() const { return _self; }
+
+   // Runs f(contract) as an action of `self` signed by `auths`. first_receiver
+   // is the notifying contract for on_notify handlers, `self` otherwise.
+   template <typename F>
+   action_result push(std::initializer_list<name> auths, name first_receiver, F&& f) {
+      auto& st = native::state();
+      st.auths.clear();
+      for (auto a : auths) st.auths.insert(a.value);
+      st.receiver       = _self.value;
+      st.first_receiver = first_receiver.value;
+
+      action_result res;
+      auto cp = native::save_checkpoint();
+      try {
+         Contract c(_self, first_receiver, eosio::datastream<const char*>(nullptr, 0));
+         f(c);
+      } catch (const native::assert_exception& e) {
+         res.ok    = false;
+         res.error = e.what();
+         native::restore_checkpoint(std::move(cp));
+      }
+      if (res.ok) {
+         res.inline_actions = st.inline_actions;
+         res.notifications  = st.notifications;
+      }
+      res.console = st.console;
+      res.stats   = st.stats;
+      res.loads   = st.loads;
+      accumulate(test_stats(), st.stats);
+      if (std::getenv("TYCHE_NATIVE_STATS"))
+         std::printf("    #%zu find=%lu get=%lu next=%lu store=%lu update=%lu remove=%lu idx=%lu%s\n", ++_pushed,
+                     st.stats.find, st.stats.get, st.stats.next, st.stats.store, st.stats.update, st.stats.remove,
+                     st.stats.idx, res.ok ? "" : " (aborted)");
+      native::begin_action();
+      return res;
+   }
+
+   template <typename F>
+   action_result push(std::initializer_list<name> auths, F&& f) {
+      return push(auths, _self, std::forward<F>(f));
+   }
+
+   void advance(const eosio::microseconds& d) { native::state().now_us += d.count(); }
+   eosio::time_point now() const { return eosio::current_time_point(); }
+
+   // Direct table access for seeding foreign contracts (token balances,
+   // oracle prices) and inspecting results.
+   template <typename Row>
+   std::optional<Row> get_row(name code, uint64_t scope, name table, uint64_t pk) const {
+      auto& r  = native::rows(code.value, scope, table.value);
+      auto  it = r.find(pk);
+      if (it == r.end()) return std::nullopt;
+      return eosio::unpack<Row>(it->second.data);
+   }
+
+   template <typename Row>
+   void set_row(name code, uint64_t scope, name table, uint64_t pk, const Row& row, name payer = name()) {
+      auto& r = native::rows(code.value, scope, table.value)[pk];
+      r.payer = (payer ? payer : code).value;
+      r.data  = eosio::pack(row);
+   }
+
+   size_t row_count(name code, uint64_t scope, name table) const {
+      return native::rows(code.value, scope, table.value).size();
+   }
+
+private:
+   name   _self;
+   size_t _pushed = 0;
+};
+
+// Unpacks the payload of a captured inline action.
+template <typename T>
+T action_data(const native::captured_action& a) {
+   return eosio::unpack<T>(a.data);
+}
+
+struct test_case {
+   const char* name;
+   void (*fn)();
+};
+
+inline std::vector<test_case>& registry() {
+   static std::vector<test_case> tests;
+   return tests;
+}
+
+inline bool add_test(const char* name, void (*fn)()) {
+   registry().push_back({name, fn});
+   return true;
+}
+
+template <typename A, typename B>
+void require_eq(const A& a, const B& b, const char* expr, const char* file, int line) {
+   if (a == b) return;
+   std::ostringstream os;
+   os << file << ":" << line << ": " << expr << " (";
+   if constexpr (std::is_arithmetic_v<A> && std::is_arithmetic_v<B>) os << +a << " != " << +b;
+   else if constexpr (std::is_convertible_v<A, std::string> && std::is_convertible_v<B, std::string>) os << std::string(a) << " != " << std::string(b);
+   else os << a.to_string() << " != " << b.to_string();
+   os << ")";
+   throw failure(os.str());
+}
+
+}} // namespace tychefi::native_test
+
+#define TYCHE_TEST(NAME)                                                                   \
+   static void NAME();                                                                     \
+   static const bool NAME##_registered = tychefi::native_test::add_test(#NAME, &NAME);     \
+   static void NAME()
+
+#define REQUIRE(COND)                                                                      \
+   do {                                                                                    \
+      if (!(COND))                                                                         \
+         throw tychefi::native_test::failure(std::string(__FILE__) + ":" +                 \
+                                             std::to_string(__LINE__) + ": " #COND);       \
+   } while (0)
+
+#define REQUIRE_EQ(A, B) tychefi::native_test::require_eq((A), (B), #A " == " #B, __FILE__, __LINE__)
+
+// 动作成功执行
+#define REQUIRE_OK(RES)                                                                    \
+   do {                                                                                    \
+      const auto& _res = (RES);                                                            \
+      if (!_res.ok)                                                                        \
+         throw tychefi::native_test::failure(std::string(__FILE__) + ":" +                 \
+                                             std::to_string(__LINE__) + ": " #RES          \
+                                             " aborted: " + _res.error);                   \
+   } while (0)
+
+// 动作被 check 拒绝, 且错误信息包含 MSG
+#define REQUIRE_ABORT(RES, MSG)                                                            \
+   do {                                                                                    \
+      const auto& _res = (RES);                                                            \
+      if (_res.ok || _res.error.find(MSG) == std::string::npos)                            \
+         throw tychefi::native_test::failure(std::string(__FILE__) + ":" +                 \
+                                             std::to_string(__LINE__) + ": " #RES          \
+                                             " expected abort \"" + std::string(MSG) +     \
+                                             "\", got " + (_res.ok ? "ok" : _res.error));  \
+   } while (0)
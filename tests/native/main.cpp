@@ -0,0 +1,35 @@
+// Runs the TYCHE_TEST cases linked into this executable.
+// usage: <exe> [substring]   only tests whose name contains substring
+
+#include <native_test.hpp>
+
+int main(int argc, char** argv) {
+   using namespace tychefi::native_test;
+   const char* filter = argc > 1 ? argv[1] : nullptr;
+
+   int run = 0, failed = 0;
+   for (const auto& t : registry()) {
+      if (filter && !std::strstr(t.name, filter)) continue;
+      ++run;
+      test_stats() = eosio::native::db_stats{};
+      std::string error;
+      try {
+         t.fn();
+      } catch (const failure& e) {
+         error = e.what();
+      } catch (const eosio::native::assert_exception& e) {
+         error = std::string("unexpected check failure: ") + e.what();
+      } catch (const std::exception& e) {
+         error = std::string("exception: ") + e.what();
+      }
+      const auto& s = test_stats();
+      if (error.empty()) {
+         std::printf("[  OK  ] %-40s db reads=%lu writes=%lu\n", t.name, s.reads(), s.writes());
+      } else {
+         ++failed;
+         std::printf("[ FAIL ] %s\n         %s\n", t.name, error.c_str());
+      }
+   }
+   std::printf("%d tests, %d failed\n", run, failed);
+   return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+#include <native_test.hpp>
+
+#include <tyche.earn.cpp>
+
+using namespace eosio;
+using namespace tychefi;
+using namespace tychefi::native_test;
+
+namespace {
+
+const name SELF      = "tyche.earn11"_n;
+const name REWARD    = "tycreward111"_n;
+const name REFUELER  = "refueler"_n;
+
+struct transfer_args {
+   name        from;
+   name        to;
+   asset       quantity;
+   std::string memo;
+};
+
+struct claimreward_args {
+   name        to;
+   name        bank;
+   asset       rewards;
+   std::string memo;
+};
+
+struct earn_tester : tester<tyche_earn> {
+   earn_tester() : tester(SELF) {
+      REQUIRE_OK( push({SELF}, [](auto& c) { c.init("admin"_n, REWARD, REFUELER, true); }) );
+   }
+
+   action_result setpool(uint64_t code, uint64_t term_sec, uint64_t multiplier = 1) {
+      return push({SELF}, [&](auto& c) { c.setpool(code, term_sec, multiplier); });
+   }
+
+   action_result deposit(name who, int64_t amount, uint64_t code) {
+      return push({who}, MUSDT_BANK, [&](auto& c) {
+         c.ontransfer(who, SELF, asset(amount, MUSDT), "deposit:" + std::to_string(code));
+      });
+   }
+
+   action_result redeem(name who, int64_t amount, const std::string& codes) {
+      return push({who}, TRUSD_BANK, [&](auto& c) { c.ontransfer(who, SELF, asset(amount, TRUSD), "redeem:" + codes); });
+   }
+
+   std::optional<earner_t> earner(uint64_t code, name owner) {
+      return get_row<earner_t>(SELF, code, "earners"_n, owner.value);
+   }
+
+   std::optional<earn_pool_t> pool(uint64_t code) {
+      return get_row<earn_pool_t>(SELF, SELF.value, "earnpools"_n, code);
+   }
+
+   action_result refuel(const extended_symbol& sym, int64_t amount, uint64_t code) {
+      return push({REWARD}, [&](auto& c) { c.refuelreward(sym.get_contract(), asset(amount, sym.get_symbol()), DAY_SECONDS, code); });
+   }
+
+   action_result compact(uint64_t code, const symbol& sym, uint32_t max_rows) {
+      return push({SELF}, [&](auto& c) { c.compactrwd(code, sym, max_rows); });
+   }
+
+   asset maturing(uint64_t code, name owner) {
+      auto day = earner(code, owner)->term_ended_at.sec_since_epoch() / DAY_SECONDS;
+      auto m   = get_row<maturity_t>(SELF, SELF.value, "maturities"_n, day);
+      return m ? m->principal : asset(0, MUSDT);
+   }
+
+   //模拟升级前写入的旧行: 没有 row_version 及之后的字段, 本金未计入到期汇总
+   void make_legacy(uint64_t code, name owner) {
+      auto row = *earner(code, owner);
+      auto day = row.term_ended_at.sec_since_epoch() / DAY_SECONDS;
+      auto m   = *get_row<maturity_t>(SELF, SELF.value, "maturities"_n, day);
+      m.principal -= row.avl_principal;
+      set_row(SELF, SELF.value, "maturities"_n, day, m);
+
+      row.maturity_counted.reset();
+      auto& data = native::rows(SELF.value, code, "earners"_n.value)[owner.value].data;
+      data       = pack(row);
+      data.pop_back();
+   }
+};
+
+} // namespace
+
+TYCHE_TEST(init_requires_self) {
+   tester<tyche_earn> t(SELF);
+   REQUIRE_ABORT( t.push({"admin"_n}, [](auto& c) { c.init("admin"_n, REWARD, REFUELER, true); }), "missing authority" );
+}
+
+TYCHE_TEST(flat_map_encodes_like_std_map) {
+   //earnpools/earners 行中的奖励表由 std::map 改为 flat_map, 存储格式须逐字节一致
+   std::map<symbol, earner_reward_st> legacy;
+   earner_reward_map                  flat;
+   for (const char* code : {"USDT", "AAAA", "TYCHE", "BBB"}) {
+      symbol sym(symbol_code(code), 4);
+      earner_reward_st r;
+      r.last_reward_per_share = int128_t(sym.raw()) << 20;
+      r.unclaimed_rewards     = asset(sym.raw() % 1000, sym);
+      r.claimed_rewards       = asset(1, sym);
+      r.total_claimed_rewards = asset(2, sym);
+      legacy[sym] = r;
+      flat[sym]   = r;
+   }
+   auto bytes = pack(legacy);
+   REQUIRE( pack(flat) == bytes );
+   REQUIRE( pack(unpack<earner_reward_map>(bytes)) == bytes );
+   REQUIRE( pack(earner_reward_map{}) == pack(std::map<symbol, earner_reward_st>{}) );
+}
+
+TYCHE_TEST(deposit_issues_lp_token) {
+   earn_tester t;
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+
+   auto res = t.deposit("alice"_n, 100'000000, 1);
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   REQUIRE_EQ( name(res.inline_actions[0].account), TRUSD_BANK );
+   auto xfer = action_data<transfer_args>(res.inline_actions[0]);
+   REQUIRE_EQ( xfer.to, "alice"_n );
+   REQUIRE_EQ( xfer.quantity, asset(100'000000, TRUSD) );
+
+   auto acct = t.earner(1, "alice"_n);
+   REQUIRE( acct.has_value() );
+   REQUIRE_EQ( acct->avl_principal, asset(100'000000, MUSDT) );
+   REQUIRE_EQ( row_version_of(*acct), earner_t::ROW_VERSION );
+}
+
+TYCHE_TEST(aborted_deposit_leaves_no_rows) {
+   earn_tester t;
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+   REQUIRE_ABORT( t.deposit("alice"_n, 100'000000, 9), "earn pool not found" );
+   REQUIRE( !t.earner(9, "alice"_n).has_value() );
+   REQUIRE_EQ( t.row_count(SELF, SELF.value, "earnsummary"_n), 0u );
+}
+
+TYCHE_TEST(redeem_after_term_returns_principal) {
+   earn_tester t;
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+   REQUIRE_OK( t.deposit("alice"_n, 100'000000, 1) );
+   REQUIRE_ABORT( t.redeem("alice"_n, 100'000000, "1"), "premature" );
+
+   t.advance(days(1));
+   auto res = t.redeem("alice"_n, 100'000000, "1");
+   REQUIRE_OK( res );
+   bool refunded = false;
+   for (const auto& a : res.inline_actions) {
+      if (name(a.account) != MUSDT_BANK) continue;
+      auto xfer = action_data<transfer_args>(a);
+      refunded  = xfer.to == "alice"_n && xfer.quantity == asset(100'000000, MUSDT);
+   }
+   REQUIRE( refunded );
+   REQUIRE( !t.earner(1, "alice"_n).has_value() );
+}
+
+//每个 action 内同一行只从链上读取并反序列化一次, 脏行只写回一次
+TYCHE_TEST(table_cache_loads_each_row_once) {
+   earn_tester t;
+   extended_symbol sym(symbol(symbol_code("AAAA"), 4), "bank1"_n);
+   REQUIRE_OK( t.push({SELF}, [&](auto& c) { c.addrewardsym(sym); }) );
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+   //新用户首次存款补建 term_codes 时会额外扫描一次 earnpools
+   auto first = t.deposit("alice"_n, 100'000000, 1);
+   REQUIRE_OK( first );
+   REQUIRE( first.max_row_loads() <= 2 );
+   REQUIRE_OK( t.push({REWARD}, [&](auto& c) { c.refuelreward(sym.get_contract(), asset(1000'0000, sym.get_symbol()), DAY_SECONDS, 0); }) );
+
+   //池子、用户、到期桶各写一次
+   auto deposit = t.deposit("alice"_n, 100'000000, 1);
+   REQUIRE_OK( deposit );
+   REQUIRE_EQ( deposit.max_row_loads(), 1 );
+   REQUIRE( deposit.stats.writes() <= 3 );
+
+   auto claim = t.push({"alice"_n}, [](auto& c) { c.claimrewards("alice"_n); });
+   REQUIRE_OK( claim );
+   REQUIRE_EQ( claim.max_row_loads(), 1 );
+
+   auto pending = t.push({"alice"_n}, [](auto& c) { c.getpending("alice"_n); });
+   REQUIRE_OK( pending );
+   REQUIRE_EQ( pending.max_row_loads(), 1 );
+   REQUIRE_EQ( pending.stats.writes(), 0u );
+}
+
+TYCHE_TEST(setpool_caps_pool_count) {
+   earn_tester t;
+   for (uint64_t code = 1; code <= MAX_EARN_POOLS; code++)
+      REQUIRE_OK( t.setpool(code, DAY_SECONDS) );
+   REQUIRE_ABORT( t.setpool(MAX_EARN_POOLS + 1, DAY_SECONDS), "too many earn pools" );
+   //已有池子仍可修改
+   REQUIRE_OK( t.setpool(1, 2 * DAY_SECONDS) );
+}
+
+TYCHE_TEST(claimrewards_resumes_from_cursor) {
+   earn_tester t;
+   const uint64_t pools = 20;
+   std::vector<extended_symbol> syms;
+   for (const char* code : {"AAAA", "AAAB", "AAAC"})
+      syms.emplace_back(symbol(symbol_code(code), 4), "bank1"_n);
+   for (auto& s : syms)
+      REQUIRE_OK( t.push({SELF}, [&](auto& c) { c.addrewardsym(s); }) );
+   for (uint64_t code = 1; code <= pools; code++) {
+      REQUIRE_OK( t.setpool(code, DAY_SECONDS) );
+      REQUIRE_OK( t.deposit("alice"_n, 100'000000, code) );
+   }
+   for (auto& s : syms)
+      REQUIRE_OK( t.push({REWARD}, [&](auto& c) { c.refuelreward(s.get_contract(), asset(1000'0000, s.get_symbol()), DAY_SECONDS, 0); }) );
+   t.advance(hours(1));
+
+   //每个池子 1 + 3 个单位, 预算 64: 第一次领取 16 个池子并记录进度
+   REQUIRE_OK( t.push({"alice"_n}, [](auto& c) { c.claimrewards("alice"_n); }) );
+   auto cursor = t.get_row<continuation_t>(SELF, "alice"_n.value, "contcursor"_n, CONT_CLAIM.value);
+   REQUIRE( cursor.has_value() );
+   REQUIRE_EQ( cursor->next_key, CLAIM_WORK_BUDGET / 4 + 1 );
+
+   //第二次领取剩余池子并删除进度
+   REQUIRE_OK( t.push({"alice"_n}, [](auto& c) { c.claimrewards("alice"_n); }) );
+   REQUIRE_EQ( t.row_count(SELF, "alice"_n.value, "contcursor"_n), 0u );
+}
+
+TYCHE_TEST(compactrwd_settles_before_dropping_symbol) {
+   earn_tester t;
+   extended_symbol sym(symbol(symbol_code("AAAA"), 4), "bank1"_n);
+   REQUIRE_OK( t.push({SELF}, [&](auto& c) { c.addrewardsym(sym); }) );
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+   //alice, bob 在奖励前存入, 没有奖励记录; carol 在奖励后存入
+   REQUIRE_OK( t.deposit("alice"_n, 100'000000, 1) );
+   REQUIRE_OK( t.deposit("bob"_n, 300'000000, 1) );
+   REQUIRE_OK( t.refuel(sym, 1000'0000, 1) );
+   REQUIRE_OK( t.deposit("carol"_n, 100'000000, 1) );
+   REQUIRE_ABORT( t.compact(1, sym.get_symbol(), 10), "still on shelf" );
+   REQUIRE_OK( t.push({SELF}, [&](auto& c) { c.onshelfsym(sym, false); }) );
+
+   //第一轮: 按最终 reward_per_share 发放未领取的奖励, 池子记录保留到全部用户结算完
+   auto res = t.compact(1, sym.get_symbol(), 2);
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 2u );
+   auto paid = action_data<claimreward_args>(res.inline_actions[0]);
+   REQUIRE_EQ( paid.to, "alice"_n );
+   REQUIRE_EQ( paid.rewards, asset(250'0000, sym.get_symbol()) );
+   REQUIRE_EQ( action_data<claimreward_args>(res.inline_actions[1]).rewards, asset(750'0000, sym.get_symbol()) );
+   REQUIRE_EQ( t.pool(1)->airdrop_rewards.count(sym.get_symbol()), 1u );
+   REQUIRE_ABORT( t.push({SELF}, [&](auto& c) { c.onshelfsym(sym, true); }), "compaction in progress" );
+
+   //carol 已是最终值, 不再发放; 遍历完成后删除池子记录
+   res = t.compact(1, sym.get_symbol(), 2);
+   REQUIRE_OK( res );
+   REQUIRE( res.inline_actions.empty() );
+   REQUIRE_EQ( t.pool(1)->airdrop_rewards.count(sym.get_symbol()), 0u );
+   REQUIRE_EQ( t.earner(1, "carol"_n)->airdrop_rewards.count(sym.get_symbol()), 1u );
+
+   //第二轮: 删除用户记录, 完成后才能重新上架
+   REQUIRE_OK( t.compact(1, sym.get_symbol(), 2) );
+   REQUIRE_OK( t.compact(1, sym.get_symbol(), 2) );
+   for (auto who : {"alice"_n, "bob"_n, "carol"_n})
+      REQUIRE( t.earner(1, who)->airdrop_rewards.empty() );
+   REQUIRE_EQ( t.row_count(SELF, sym.get_symbol().code().raw(), "rwdcompact"_n), 0u );
+
+   //重新上架后池子记录从 0 重建, 用户按新的 reward_per_share 领取
+   REQUIRE_OK( t.push({SELF}, [&](auto& c) { c.onshelfsym(sym, true); }) );
+   REQUIRE_OK( t.refuel(sym, 500'0000, 1) );
+   res = t.push({"carol"_n}, [](auto& c) { c.claimrewards("carol"_n); });
+   REQUIRE_OK( res );
+   REQUIRE_EQ( action_data<claimreward_args>(res.inline_actions[0]).rewards, asset(100'0000, sym.get_symbol()) );
+}
+
+TYCHE_TEST(initmaturity_counts_each_row_once) {
+   earn_tester t;
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+   for (auto who : {"alice"_n, "bob"_n, "carol"_n})
+      REQUIRE_OK( t.deposit(who, 100'000000, 1) );
+   t.make_legacy(1, "bob"_n);
+   t.make_legacy(1, "carol"_n);
+   REQUIRE_EQ( row_version_of(*t.earner(1, "bob"_n)), 0 );
+   REQUIRE_EQ( t.maturing(1, "alice"_n), asset(100'000000, MUSDT) );
+
+   //升级后存入的旧行整行计入, initmaturity 不再重复计入
+   REQUIRE_OK( t.deposit("carol"_n, 50'000000, 1) );
+   REQUIRE( t.earner(1, "carol"_n)->maturity_counted.value() );
+   REQUIRE_EQ( t.maturing(1, "carol"_n), asset(250'000000, MUSDT) );
+
+   for (int i = 0; i < 2; i++)
+      REQUIRE_OK( t.push({SELF}, [](auto& c) { c.initmaturity(1, name(), 10); }) );
+   REQUIRE_EQ( t.maturing(1, "alice"_n), asset(350'000000, MUSDT) );
+
+   //未计入的旧行赎回时不扣减汇总
+   t.make_legacy(1, "bob"_n);
+   REQUIRE_EQ( t.maturing(1, "alice"_n), asset(250'000000, MUSDT) );
+   t.advance(days(1));
+   REQUIRE_OK( t.redeem("bob"_n, 100'000000, "1") );
+   REQUIRE_EQ( t.maturing(1, "alice"_n), asset(250'000000, MUSDT) );
+   REQUIRE_OK( t.redeem("alice"_n, 100'000000, "1") );
+   REQUIRE_OK( t.redeem("carol"_n, 150'000000, "1") );
+   REQUIRE_EQ( t.row_count(SELF, SELF.value, "maturities"_n), 0u );
+}
+
+TYCHE_TEST(claimreward_compounds_interest_when_enabled) {
+   earn_tester t;
+   REQUIRE_OK( t.setpool(1, DAY_SECONDS) );
+   REQUIRE_OK( t.deposit("alice"_n, 100'000000, 1) );
+   REQUIRE_OK( t.deposit("bob"_n, 100'000000, 1) );
+   REQUIRE_OK( t.push({"alice"_n}, [](auto& c) { c.setcompound("alice"_n, true); }) );
+   REQUIRE_OK( t.push({REWARD}, [](auto& c) { c.refuelintrst(MUSDT_BANK, asset(10'000000, MUSDT), DAY_SECONDS); }) );
+
+   //开启复投: 利息由 reward 合约转入本合约并计入本金, 发放对应的 TRUSD
+   auto res = t.push({"alice"_n}, [](auto& c) { c.claimreward("alice"_n, "6,USDT"); });
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 2u );
+   auto compounded = action_data<claimreward_args>(res.inline_actions[0]);
+   REQUIRE_EQ( compounded.to, SELF );
+   REQUIRE_EQ( compounded.rewards, asset(5'000000, MUSDT) );
+   REQUIRE_EQ( compounded.memo, std::string("compound:all") );
+   auto credential = action_data<transfer_args>(res.inline_actions[1]);
+   REQUIRE_EQ( credential.to, "alice"_n );
+   REQUIRE_EQ( credential.quantity, asset(5'000000, TRUSD) );
+   REQUIRE_EQ( t.earner(1, "alice"_n)->avl_principal, asset(105'000000, MUSDT) );
+   REQUIRE_EQ( t.pool(1)->avl_principal, asset(205'000000, MUSDT) );
+   REQUIRE_EQ( t.maturing(1, "alice"_n), asset(205'000000, MUSDT) );
+
+   //未开启的用户照常领取
+   res = t.push({"bob"_n}, [](auto& c) { c.claimreward("bob"_n, "6,USDT"); });
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   auto paid = action_data<claimreward_args>(res.inline_actions[0]);
+   REQUIRE_EQ( paid.to, "bob"_n );
+   REQUIRE_EQ( paid.rewards, asset(5'000000, MUSDT) );
+   REQUIRE_EQ( t.earner(1, "bob"_n)->avl_principal, asset(100'000000, MUSDT) );
+}
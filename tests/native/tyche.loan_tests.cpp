@@ -0,0 +1,416 @@
+#include <native_test.hpp>
+
+#include <tyche.loan.cpp>
+
+using namespace eosio;
+using namespace tychefi;
+using namespace tychefi::native_test;
+
+namespace {
+
+const name   SELF      = "tyche.loan11"_n;
+const name   ORACLE    = "price.oracle"_n;
+const name   ADMIN     = "admin"_n;
+const name   REFUELER  = "refueler"_n;
+const symbol BTC       = symbol(symbol_code("BTC"), 8);
+
+struct transfer_args {
+   name        from;
+   name        to;
+   asset       quantity;
+   std::string memo;
+};
+
+using liqbatch_args = std::tuple<std::vector<liqlog_t>, std::vector<liqleg_t>>;
+
+struct loan_tester : tester<tyche_loan> {
+   uint64_t price_id = 0;
+
+   loan_tester() : tester(SELF) {
+      REQUIRE_OK( push({SELF}, [](auto& c) { c.init(ADMIN, REFUELER, ORACLE, "tycheproxy11"_n, true); }) );
+      set_price(60000'000000);
+      REQUIRE_OK( push({ADMIN}, [](auto& c) { c.setcallatsym(extended_symbol(BTC, MUSDT_BANK), "btc"_n); }) );
+      REQUIRE_OK( push({ADMIN}, [](auto& c) { c.setcollquant(BTC, asset(0, BTC), asset(1000'00000000, BTC)); }) );
+      REQUIRE_OK( push({REFUELER}, MUSDT_BANK, [](auto& c) { c.ontransfer(REFUELER, SELF, asset(100000'000000, MUSDT), "fund"); }) );
+      REQUIRE_OK( add_interest(1000) );
+   }
+
+   //喂价: 全局最新价及按币种的历史记录, 与 price.oracle 写入的一致
+   void set_price(uint64_t price) {
+      price_global_t g;
+      g.prices["btc"_n] = price;
+      set_row(ORACLE, ORACLE.value, "global"_n, "global"_n.value, g);
+      coin_price_t cp(++price_id);
+      cp.tpcode     = "btc"_n;
+      cp.price      = asset(price, symbol(symbol_code("USDT"), 6));
+      cp.updated_at = now();
+      set_row(ORACLE, "btc"_n.value, "prices"_n, cp.id, cp);
+   }
+
+   //推进时间, 价格保持新鲜
+   void pass_days(int d) {
+      advance(days(d));
+      set_price(60000'000000);
+   }
+
+   action_result add_interest(uint64_t ratio) {
+      return push({ADMIN}, [&](auto& c) { c.addinterest(ratio); });
+   }
+
+   action_result collateral(name who, int64_t amount) {
+      return push({who}, MUSDT_BANK, [&](auto& c) { c.ontransfer(who, SELF, asset(amount, BTC), "collateral"); });
+   }
+
+   action_result borrow(name who, int64_t amount) {
+      return push({who}, [&](auto& c) { c.getmoreusdt(who, BTC, asset(amount, MUSDT)); });
+   }
+
+   std::optional<loaner_t> loaner(name owner) {
+      return get_row<loaner_t>(SELF, "btc"_n.value, "loaners"_n, owner.value);
+   }
+
+   action_result liqbuys(name from, int64_t amount, const std::string& accounts) {
+      return push({from}, MUSDT_BANK, [&](auto& c) { c.ontransfer(from, SELF, asset(amount, MUSDT), "liqbuys:8,BTC:" + accounts); });
+   }
+
+   std::optional<collateral_symbol_t> collsym() {
+      return get_row<collateral_symbol_t>(SELF, SELF.value, "collsyms"_n, BTC.code().raw());
+   }
+
+   std::optional<recent_liq_t> recent_liq(uint64_t slot) {
+      return get_row<recent_liq_t>(SELF, SELF.value, "recentliqs"_n, slot);
+   }
+
+   std::optional<liq_stat_t> liq_stat() {
+      return get_row<liq_stat_t>(SELF, SELF.value, "liqstats"_n, BTC.code().raw());
+   }
+
+   std::optional<trigger_cursor_t> trigger_cursor() {
+      return get_row<trigger_cursor_t>(SELF, SELF.value, "trgcursor"_n, BTC.code().raw());
+   }
+
+   std::optional<loan_trigger_t> trigger(name owner) {
+      return get_row<loan_trigger_t>(SELF, "btc"_n.value, "triggers"_n, owner.value);
+   }
+
+   //模拟升级前写入的旧行: 没有 settled_index
+   void make_legacy(name owner) {
+      auto row = *loaner(owner);
+      row.settled_index.reset();
+      row.row_version.reset();
+      set_row(SELF, "btc"_n.value, "loaners"_n, owner.value, row, SELF);
+   }
+};
+
+//各抵押 1 BTC(60000 USDT): alice 借 10000, bob/carol 各借 35000
+void borrow_three(loan_tester& t) {
+   for (auto [who, amount] : {std::pair{"alice"_n, 10000'000000LL}, {"bob"_n, 35000'000000LL}, {"carol"_n, 35000'000000LL}}) {
+      REQUIRE_OK( t.collateral(who, 1'00000000) );
+      REQUIRE_OK( t.borrow(who, amount) );
+   }
+}
+
+} // namespace
+
+TYCHE_TEST(borrow_transfers_principal) {
+   loan_tester t;
+   REQUIRE_OK( t.collateral("alice"_n, 1'00000000) );
+
+   auto res = t.borrow("alice"_n, 10000'000000);
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   REQUIRE_EQ( name(res.inline_actions[0].account), MUSDT_BANK );
+   auto xfer = action_data<transfer_args>(res.inline_actions[0]);
+   REQUIRE_EQ( xfer.to, "alice"_n );
+   REQUIRE_EQ( xfer.quantity, asset(10000'000000, MUSDT) );
+
+   auto acct = t.loaner("alice"_n);
+   REQUIRE( acct.has_value() );
+   REQUIRE_EQ( acct->avl_principal, asset(10000'000000, MUSDT) );
+   REQUIRE( acct->settled_index.has_value() );
+}
+
+TYCHE_TEST(table_access_loads_each_row_once) {
+   //同一 action 内 loaners/collsyms/triggers 各行只读取一次, 结算后的用户行不再重新加载
+   loan_tester t;
+   REQUIRE_EQ( t.collateral("alice"_n, 1'00000000).max_row_loads(), 1 );
+   REQUIRE_EQ( t.collateral("alice"_n, 1'00000000).max_row_loads(), 1 );
+   REQUIRE_EQ( t.borrow("alice"_n, 10000'000000).max_row_loads(), 1 );
+   t.pass_days(1);
+   auto repay = t.push({"alice"_n}, MUSDT_BANK, [](auto& c) { c.ontransfer("alice"_n, SELF, asset(1000'000000, MUSDT), "sendback:8,BTC"); });
+   REQUIRE_OK( repay );
+   REQUIRE_EQ( repay.max_row_loads(), 1 );
+   auto sub = t.push({"alice"_n}, [](auto& c) { c.onsubcallat("alice"_n, asset(10000000, BTC)); });
+   REQUIRE_OK( sub );
+   REQUIRE_EQ( sub.max_row_loads(), 1 );
+}
+
+TYCHE_TEST(borrow_over_ratio_aborts) {
+   loan_tester t;
+   REQUIRE_OK( t.collateral("alice"_n, 1'00000000) );
+   REQUIRE_ABORT( t.borrow("alice"_n, 59000'000000), "callation ratio exceeded" );
+   REQUIRE_EQ( t.loaner("alice"_n)->avl_principal.amount, 0 );
+}
+
+TYCHE_TEST(borrow_requires_fresh_price) {
+   loan_tester t;
+   REQUIRE_OK( t.collateral("alice"_n, 1'00000000) );
+   t.advance(days(1));
+   REQUIRE( !t.borrow("alice"_n, 1000'000000).ok );
+   t.set_price(60000'000000);
+   REQUIRE_OK( t.borrow("alice"_n, 1000'000000) );
+}
+
+TYCHE_TEST(long_history_settles_in_batches) {
+   loan_tester t;
+   for (auto who : {"alice"_n, "bob"_n}) {
+      REQUIRE_OK( t.collateral(who, 1'00000000) );
+      REQUIRE_OK( t.borrow(who, 10000'000000) );
+   }
+   t.make_legacy("bob"_n);
+
+   //利率区间数超过单次预算
+   const uint32_t periods = INTEREST_HISTORY_BUDGET + 8;
+   for (uint32_t i = 0; i < periods; i++) {
+      t.pass_days(1);
+      REQUIRE_OK( t.add_interest(1000 + 100 * (i % 5)) );
+   }
+   t.pass_days(1);
+   REQUIRE_ABORT( t.borrow("bob"_n, 1'000000), "interest history too long" );
+
+   REQUIRE_OK( t.push({"bob"_n}, [](auto& c) { c.settlehist(BTC, "bob"_n); }) );
+   REQUIRE( !t.loaner("bob"_n)->settled_index.has_value() );
+   REQUIRE_OK( t.push({"bob"_n}, [](auto& c) { c.settlehist(BTC, "bob"_n); }) );
+   REQUIRE( t.loaner("bob"_n)->settled_index.has_value() );
+   REQUIRE_ABORT( t.push({"bob"_n}, [](auto& c) { c.settlehist(BTC, "bob"_n); }), "already indexed" );
+
+   //分批结算与按指数结算的利息一致: 逐区间结算每个区间向下取整, 误差不超过区间数
+   REQUIRE_OK( t.borrow("alice"_n, 1'000000) );
+   REQUIRE_OK( t.borrow("bob"_n, 1'000000) );
+   auto alice_interest = t.loaner("alice"_n)->unpaid_interest.amount;
+   auto bob_interest   = t.loaner("bob"_n)->unpaid_interest.amount;
+   REQUIRE( alice_interest > 0 );
+   REQUIRE( alice_interest >= bob_interest );
+   REQUIRE( alice_interest - bob_interest <= periods + 1 );
+}
+
+TYCHE_TEST(settlehist_charges_first_period_unlike_legacy_scan) {
+   loan_tester t;
+   for (auto who : {"bob"_n, "carol"_n}) {
+      REQUIRE_OK( t.collateral(who, 1'00000000) );
+      REQUIRE_OK( t.borrow(who, 10000'000000) );
+      t.make_legacy(who);
+   }
+   //借款所在区间 1000, 之后 1100, 1200 各一天
+   for (uint64_t ratio : {1100, 1200}) {
+      t.pass_days(1);
+      REQUIRE_OK( t.add_interest(ratio) );
+   }
+   t.pass_days(1);
+
+   //bob 经 settlehist 结算, carol 经旧的逐区间扫描结算
+   REQUIRE_OK( t.push({"bob"_n}, [](auto& c) { c.settlehist(BTC, "bob"_n); }) );
+   REQUIRE_OK( t.borrow("bob"_n, 1'000000) );
+   REQUIRE_OK( t.borrow("carol"_n, 1'000000) );
+   auto settled = t.loaner("bob"_n)->unpaid_interest.amount;
+   auto legacy  = t.loaner("carol"_n)->unpaid_interest.amount;
+
+   //两者只差借款所在区间: 10000 USDT x 10% x 1 天
+   auto one_day = [](int64_t ratio) { return 10000'000000LL * ratio / PCT_BOOST * DAY_SECONDS / YEAR_SECONDS; };
+   REQUIRE_EQ( legacy, one_day(1100) + one_day(1200) );
+   REQUIRE_EQ( settled - legacy, one_day(1000) );
+}
+
+TYCHE_TEST(interest_index_is_created_explicitly) {
+   loan_tester t;
+   REQUIRE_EQ( t.row_count(SELF, SELF.value, "interestidx"_n), 1u );
+
+   //模拟升级前的部署: 没有累计指数, 借款/还款只读不建立, 按 interests 历史结算
+   native::rows(SELF.value, SELF.value, "interestidx"_n.value).erase("interestidx"_n.value);
+   REQUIRE_OK( t.collateral("alice"_n, 1'00000000) );
+   REQUIRE_OK( t.borrow("alice"_n, 10000'000000) );
+   REQUIRE( !t.loaner("alice"_n)->settled_index.has_value() );
+   t.pass_days(1);
+   REQUIRE_ABORT( t.liqbuys("dave"_n, 1000'000000, "alice"), "no account can be liquidated" );
+   REQUIRE_EQ( t.row_count(SELF, SELF.value, "interestidx"_n), 0u );
+
+   //migraterows 建立指数, 之后结算的用户改按指数计息
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.migraterows(BTC, name(), 10); }) );
+   REQUIRE_EQ( t.row_count(SELF, SELF.value, "interestidx"_n), 1u );
+   REQUIRE_OK( t.borrow("alice"_n, 1'000000) );
+   REQUIRE( t.loaner("alice"_n)->settled_index.has_value() );
+   REQUIRE_EQ( t.loaner("alice"_n)->unpaid_interest.amount, int64_t(10000'000000LL * 1000 / PCT_BOOST * DAY_SECONDS / YEAR_SECONDS) );
+}
+
+TYCHE_TEST(setpriceage_bounds_oracle_price_age) {
+   loan_tester t;
+   REQUIRE_OK( t.collateral("alice"_n, 1'00000000) );
+   REQUIRE_ABORT( t.push({"alice"_n}, [](auto& c) { c.setpriceage(7200); }), "missing authority" );
+
+   //默认有效期 DEFAULT_MAX_PRICE_AGE_SEC
+   t.advance(seconds(DEFAULT_MAX_PRICE_AGE_SEC + 1));
+   REQUIRE_ABORT( t.borrow("alice"_n, 1000'000000), "price expired" );
+
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.setpriceage(7200); }) );
+   REQUIRE_OK( t.borrow("alice"_n, 1000'000000) );
+   t.advance(seconds(7200));
+   REQUIRE_ABORT( t.borrow("alice"_n, 1000'000000), "price expired" );
+
+   //0 不检查
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.setpriceage(0); }) );
+   t.advance(days(30));
+   REQUIRE_OK( t.borrow("alice"_n, 1000'000000) );
+}
+
+TYCHE_TEST(triggers_follow_debt_and_updtriggers) {
+   loan_tester t;
+   for (auto who : {"alice"_n, "bob"_n}) {
+      REQUIRE_OK( t.collateral(who, 1'00000000) );
+      REQUIRE( !t.trigger(who).has_value() );
+      REQUIRE_OK( t.borrow(who, 10000'000000) );
+   }
+   //1 BTC 借 10000 USDT: 清算线 150%, 强平线 120%
+   REQUIRE_EQ( t.trigger("alice"_n)->liq_price, 15000'000000u );
+   REQUIRE_EQ( t.trigger("alice"_n)->force_price, 12000'000000u );
+
+   //只改初始抵押率不影响触发价
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.setsymratio(BTC, 20000, 15000, 12000); }) );
+   REQUIRE( !t.trigger_cursor().has_value() );
+
+   //调整清算/强平线后标记待重建, updtriggers 从记录的位置分批续做
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.setsymratio(BTC, 20000, 16000, 13000); }) );
+   REQUIRE_EQ( t.trigger_cursor()->next_owner, name() );
+   REQUIRE_ABORT( t.push({"alice"_n}, [](auto& c) { c.updtriggers(BTC, name(), 10); }), "missing authority" );
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.updtriggers(BTC, name(), 1); }) );
+   REQUIRE_EQ( t.trigger("alice"_n)->liq_price, 16000'000000u );
+   REQUIRE_EQ( t.trigger("bob"_n)->liq_price, 15000'000000u );
+   REQUIRE_EQ( t.trigger_cursor()->next_owner, "bob"_n );
+   REQUIRE_OK( t.push({ADMIN}, [](auto& c) { c.updtriggers(BTC, name(), 1); }) );
+   REQUIRE_EQ( t.trigger("bob"_n)->liq_price, 16000'000000u );
+   REQUIRE_EQ( t.trigger("bob"_n)->force_price, 13000'000000u );
+   REQUIRE( !t.trigger_cursor().has_value() );
+
+   //还清后删除
+   REQUIRE_OK( t.push({"bob"_n}, MUSDT_BANK, [](auto& c) { c.ontransfer("bob"_n, SELF, asset(10000'000000, MUSDT), "sendback:8,BTC"); }) );
+   REQUIRE_EQ( t.loaner("bob"_n)->avl_principal.amount, 0 );
+   REQUIRE( !t.trigger("bob"_n).has_value() );
+}
+
+TYCHE_TEST(liqbuys_skips_healthy_accounts_and_refunds_once) {
+   loan_tester t;
+   borrow_three(t);
+   //50000: bob/carol 抵押率 142% 进入清算区间, alice 500% 跳过
+   t.set_price(50000'000000);
+   REQUIRE_ABORT( t.liqbuys("dave"_n, 1000'000000, "alice"), "no account can be liquidated" );
+
+   auto res = t.liqbuys("dave"_n, 100000'000000, "alice,bob,carol,bob");
+   REQUIRE_OK( res );
+   auto alice = *t.loaner("alice"_n);
+   auto bob   = *t.loaner("bob"_n);
+   auto carol = *t.loaner("carol"_n);
+   REQUIRE_EQ( alice.avl_principal, asset(10000'000000, MUSDT) );
+   REQUIRE_EQ( alice.avl_collateral_quant, asset(1'00000000, BTC) );
+   REQUIRE( bob.avl_principal.amount == 0 && carol.avl_principal.amount == 0 );
+
+   //买到的抵押物与剩余 MUSDT 各一笔, 重复的 bob 只清算一次
+   REQUIRE_EQ( res.inline_actions.size(), 3u );
+   auto bought = action_data<transfer_args>(res.inline_actions[0]);
+   auto change = action_data<transfer_args>(res.inline_actions[1]);
+   auto [logs, legs] = action_data<liqbatch_args>(res.inline_actions[2]);
+   REQUIRE_EQ( name(res.inline_actions[2].name), "liqbatch"_n );
+   REQUIRE_EQ( logs.size(), 2u );
+   REQUIRE_EQ( legs.size(), 4u );
+   REQUIRE( logs[0].liquidator == "bob"_n && logs[1].liquidator == "carol"_n );
+   REQUIRE_EQ( bought.to, "dave"_n );
+   REQUIRE_EQ( bought.quantity, asset(2'00000000, BTC) - bob.avl_collateral_quant - carol.avl_collateral_quant );
+   REQUIRE_EQ( change.to, "dave"_n );
+   REQUIRE_EQ( change.memo, TYPE_GIVE_CHANGE_LIQ );
+   REQUIRE( change.quantity.amount > 0 && change.quantity.amount < 100000'000000 - 70000'000000 );
+}
+
+TYCHE_TEST(forceliqs_closes_only_accounts_below_force_ratio) {
+   loan_tester t;
+   borrow_three(t);
+   //40000: bob/carol 抵押率 114% 低于强平线 120%
+   t.set_price(40000'000000);
+   REQUIRE_ABORT( t.push({"system"_n}, [](auto& c) { c.forceliqs("system"_n, BTC, {"alice"_n}); }), "no account can be liquidated" );
+
+   auto res = t.push({"system"_n}, [](auto& c) { c.forceliqs("system"_n, BTC, {"alice"_n, "bob"_n, "carol"_n}); });
+   REQUIRE_OK( res );
+   //没有转账, 只有一条批量事件
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   auto logs = std::get<0>( action_data<liqbatch_args>(res.inline_actions[0]) );
+   REQUIRE_EQ( logs.size(), 2u );
+   REQUIRE( logs[0].liqtype == "forceliq"_n && logs[1].liqtype == "forceliq"_n );
+   REQUIRE_EQ( t.loaner("alice"_n)->avl_principal, asset(10000'000000, MUSDT) );
+   for (auto who : {"bob"_n, "carol"_n}) {
+      REQUIRE_EQ( t.loaner(who)->avl_principal.amount, 0 );
+      REQUIRE_EQ( t.loaner(who)->avl_collateral_quant.amount, 0 );
+      REQUIRE( !t.trigger(who).has_value() );
+   }
+   REQUIRE_EQ( t.collsym()->avl_force_collateral_quant, asset(2'00000000, BTC) );
+   REQUIRE_EQ( t.collsym()->avl_force_principal, asset(70000'000000, MUSDT) );
+}
+
+TYCHE_TEST(forceliqs_closes_accounts_at_force_ratio) {
+   loan_tester t;
+   borrow_three(t);
+   //42000: bob/carol 抵押率正好 120%, forceliq 与 forceliqs 都应强平
+   t.set_price(42000'000000);
+   REQUIRE_OK( t.push({"system"_n}, [](auto& c) { c.forceliq("system"_n, "carol"_n, BTC); }) );
+   REQUIRE_EQ( t.loaner("carol"_n)->avl_principal.amount, 0 );
+
+   auto res = t.push({"system"_n}, [](auto& c) { c.forceliqs("system"_n, BTC, {"bob"_n}); });
+   REQUIRE_OK( res );
+   auto logs = std::get<0>( action_data<liqbatch_args>(res.inline_actions[0]) );
+   REQUIRE_EQ( logs.size(), 1u );
+   REQUIRE_EQ( logs[0].liqtype, "forceliq"_n );
+   REQUIRE_EQ( logs[0].collateral_ratio, 12000u );
+   REQUIRE_EQ( t.loaner("bob"_n)->avl_principal.amount, 0 );
+   REQUIRE_EQ( t.collsym()->avl_force_collateral_quant, asset(2'00000000, BTC) );
+}
+
+TYCHE_TEST(liquidation_loads_each_row_once) {
+   loan_tester t;
+   borrow_three(t);
+   t.set_price(50000'000000);
+   std::vector<action_result> results;
+   results.push_back( t.push({"dave"_n}, MUSDT_BANK, [](auto& c) { c.ontransfer("dave"_n, SELF, asset(1000'000000, MUSDT), "liqbuy:8,BTC:bob"); }) );
+   results.push_back( t.liqbuys("dave"_n, 1000'000000, "bob,carol") );
+   t.set_price(40000'000000);
+   results.push_back( t.push({"system"_n}, [](auto& c) { c.forceliq("system"_n, "bob"_n, BTC); }) );
+   results.push_back( t.push({"system"_n}, [](auto& c) { c.forceliqs("system"_n, BTC, {"carol"_n}); }) );
+   for (const auto& res : results) {
+      REQUIRE_OK( res );
+      REQUIRE_EQ( res.max_row_loads(), 1 );
+   }
+}
+
+TYCHE_TEST(liquidations_fill_recent_ring_and_stats) {
+   loan_tester t;
+   borrow_three(t);
+   t.set_price(50000'000000);
+   REQUIRE_OK( t.liqbuys("dave"_n, 10000'000000, "bob") );
+   auto bought = t.recent_liq(1)->liqlog.paid_collateral_quant;
+   REQUIRE_EQ( t.recent_liq(1)->liqlog.liquidator, "bob"_n );
+
+   //编号到达容量后回绕, 新记录覆盖同一 slot, 行数不变
+   globalidx idx;
+   idx.liqlog_id = RECENT_LIQ_CAPACITY;
+   t.set_row(SELF, SELF.value, "globalidx"_n, "globalidx"_n.value, idx, SELF);
+   t.set_price(40000'000000);
+   REQUIRE_OK( t.push({"system"_n}, [](auto& c) { c.forceliqs("system"_n, BTC, {"carol"_n}); }) );
+   REQUIRE_EQ( t.row_count(SELF, SELF.value, "recentliqs"_n), 1u );
+   auto recent = t.recent_liq(1)->liqlog;
+   REQUIRE_EQ( recent.id, RECENT_LIQ_CAPACITY + 1 );
+   REQUIRE_EQ( recent.liquidator, "carol"_n );
+   REQUIRE_EQ( recent.liqtype, "forceliq"_n );
+
+   //统计按抵押币种累计, 不受回绕影响
+   auto stat = *t.liq_stat();
+   REQUIRE_EQ( stat.liq_count, 1u );
+   REQUIRE_EQ( stat.force_count, 1u );
+   REQUIRE_EQ( stat.liq_collateral_quant, bought );
+   REQUIRE_EQ( stat.force_collateral_quant, asset(1'00000000, BTC) );
+   REQUIRE_EQ( stat.last_liqlog_id, RECENT_LIQ_CAPACITY + 1 );
+}
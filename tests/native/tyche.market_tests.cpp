@@ -0,0 +1,181 @@
+#include <native_test.hpp>
+
+#include <tyche.market.cpp>
+
+using namespace eosio;
+using namespace tychefi;
+using namespace tychefi::native_test;
+
+namespace {
+
+const name   SELF   = "tyche.mark32"_n;
+const name   ADMIN  = "flonian"_n;
+const name   BANK   = "flon.mtoken"_n;
+const symbol ETH    = symbol(symbol_code("ETH"), 8);
+const symbol USDT   = symbol(symbol_code("USDT"), 6);
+
+struct transfer_args {
+   name        from;
+   name        to;
+   asset       quantity;
+   std::string memo;
+};
+
+//与 tests/tyche.market/1-tests.sh 相同的初始配置: ETH 可抵押, USDT 不可抵押
+struct market_tester : tester<tyche_market> {
+   market_tester() : tester(SELF) {
+      REQUIRE_OK( push({SELF}, [](auto& c) { c.init(ADMIN); }) );
+      REQUIRE_OK( push({ADMIN}, [](auto& c) { c.setpricettl(600); }) );
+      REQUIRE_OK( add_reserve(ETH, 7500, 8000, 11000, 1000, 8000, 200, 800, 3000) );
+      REQUIRE_OK( add_reserve(USDT, 0, 0, 10500, 1000, 8000, 200, 600, 2000) );
+      feed_prices();
+   }
+
+   action_result add_reserve(symbol sym, uint64_t max_ltv, uint64_t liq_threshold, uint64_t liq_bonus,
+                             uint64_t reserve_factor, uint64_t u_opt, uint64_t r0, uint64_t r_opt, uint64_t r_max) {
+      return push({ADMIN}, [&](auto& c) {
+         c.addreserve(extended_symbol(sym, BANK), max_ltv, liq_threshold, liq_bonus, reserve_factor, u_opt, r0, r_opt, r_max);
+      });
+   }
+
+   void feed_prices() {
+      REQUIRE_OK( push({ADMIN}, [](auto& c) { c.setprice(ETH.code(), asset(8000'000000, USDT)); }) );
+      REQUIRE_OK( push({ADMIN}, [](auto& c) { c.setprice(USDT.code(), asset(1'000000, USDT)); }) );
+   }
+
+   action_result transfer_in(name from, const asset& quantity, const std::string& memo) {
+      return push({from}, BANK, [&](auto& c) { c.on_transfer(from, SELF, quantity, memo); });
+   }
+
+   action_result borrow(name owner, const asset& quantity) {
+      return push({owner}, [&](auto& c) { c.borrow(owner, quantity); });
+   }
+
+   std::optional<position_row> position(name owner, symbol sym) {
+      return get_row<position_row>(SELF, owner.value, "positions"_n, sym.code().raw());
+   }
+
+   std::optional<reserve_state> reserve(symbol sym) {
+      return get_row<reserve_state>(SELF, SELF.value, "reserves"_n, sym.code().raw());
+   }
+};
+
+//bob 抵押 2 ETH(16000 USDT), alice 提供 20000 USDT 流动性
+void supply_both(market_tester& t) {
+   REQUIRE_OK( t.transfer_in("bob"_n, asset(2'00000000, ETH), "supply") );
+   REQUIRE_OK( t.transfer_in("alice"_n, asset(20000'000000, USDT), "supply") );
+   REQUIRE_OK( t.push({"bob"_n}, [](auto& c) { c.setcollat("bob"_n, ETH.code(), true); }) );
+}
+
+} // namespace
+
+TYCHE_TEST(supply_creates_position) {
+   market_tester t;
+   REQUIRE_OK( t.transfer_in("bob"_n, asset(2'00000000, ETH), "supply") );
+
+   auto pos = t.position("bob"_n, ETH);
+   REQUIRE( pos.has_value() );
+   REQUIRE( pos->supply_shares.amount > 0 );
+   REQUIRE_EQ( row_version_of(*pos), position_row::ROW_VERSION );
+   REQUIRE_EQ( t.reserve(ETH)->total_liquidity, asset(2'00000000, ETH) );
+}
+
+TYCHE_TEST(unknown_memo_aborts) {
+   market_tester t;
+   REQUIRE_ABORT( t.transfer_in("bob"_n, asset(1'00000000, ETH), "donate"), "unknown transfer memo" );
+   REQUIRE( !t.position("bob"_n, ETH).has_value() );
+}
+
+TYCHE_TEST(borrow_against_collateral) {
+   market_tester t;
+   supply_both(t);
+
+   REQUIRE( !t.borrow("charlie"_n, asset(1000'000000, USDT)).ok );
+   REQUIRE_ABORT( t.push({"alice"_n}, [](auto& c) { c.setcollat("alice"_n, USDT.code(), true); }), "not collateralizable" );
+
+   auto res = t.borrow("bob"_n, asset(2000'000000, USDT));
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   auto xfer = action_data<transfer_args>(res.inline_actions[0]);
+   REQUIRE_EQ( name(res.inline_actions[0].account), BANK );
+   REQUIRE_EQ( xfer.to, "bob"_n );
+   REQUIRE_EQ( xfer.quantity, asset(2000'000000, USDT) );
+   REQUIRE_EQ( t.reserve(USDT)->total_liquidity, asset(18000'000000, USDT) );
+}
+
+TYCHE_TEST(borrow_limited_by_ltv) {
+   market_tester t;
+   supply_both(t);
+   //2 ETH x 8000 x 75% = 12000
+   REQUIRE_ABORT( t.borrow("bob"_n, asset(12001'000000, USDT)), "exceeds max LTV" );
+   REQUIRE_OK( t.borrow("bob"_n, asset(11999'000000, USDT)) );
+}
+
+TYCHE_TEST(stale_price_blocks_borrow) {
+   market_tester t;
+   supply_both(t);
+   t.advance(seconds(601));
+   REQUIRE_ABORT( t.borrow("bob"_n, asset(1000'000000, USDT)), "price stale" );
+   t.feed_prices();
+   REQUIRE_OK( t.borrow("bob"_n, asset(1000'000000, USDT)) );
+}
+
+TYCHE_TEST(repay_clears_debt) {
+   market_tester t;
+   supply_both(t);
+   REQUIRE_OK( t.borrow("bob"_n, asset(2000'000000, USDT)) );
+   t.advance(days(1));
+   t.feed_prices();
+
+   //多付的部分退回
+   auto res = t.transfer_in("bob"_n, asset(2100'000000, USDT), "repay:bob");
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   auto refund = action_data<transfer_args>(res.inline_actions[0]);
+   REQUIRE_EQ( refund.to, "bob"_n );
+   REQUIRE( refund.quantity.amount > 0 && refund.quantity.amount < 100'000000 );
+
+   auto pos = t.position("bob"_n, USDT);
+   REQUIRE( pos.has_value() );
+   REQUIRE( pos->borrow.borrow_scaled == 0 && pos->borrow.accrued_interest == 0 );
+}
+
+TYCHE_TEST(withdraw_never_exceeds_balance) {
+   market_tester t;
+   supply_both(t);
+   REQUIRE_ABORT( t.push({"alice"_n}, [](auto& c) { c.withdraw("alice"_n, asset(20000'000001, USDT)); }), "exceeds balance" );
+   //池子保留流动性缓冲, 只取一半; 赎回份额向上取整, 剩余份额不超过一半
+   auto shares = t.position("alice"_n, USDT)->supply_shares.amount;
+   REQUIRE_OK( t.push({"alice"_n}, [](auto& c) { c.withdraw("alice"_n, asset(10000'000000, USDT)); }) );
+   REQUIRE( t.position("alice"_n, USDT)->supply_shares.amount * 2 <= shares );
+}
+
+TYCHE_TEST(addreserve_caps_reserve_count) {
+   market_tester t;
+   for (uint32_t i = 2; i < MAX_RESERVES; i++) {
+      std::string code = "TK";
+      code += char('A' + i / 26);
+      code += char('A' + i % 26);
+      REQUIRE_OK( t.add_reserve(symbol(symbol_code(code), 4), 5000, 6000, 10500, 1000, 8000, 200, 600, 2000) );
+   }
+   REQUIRE_ABORT( t.add_reserve(symbol(symbol_code("TKZZ"), 4), 5000, 6000, 10500, 1000, 8000, 200, 600, 2000),
+                  "too many reserves" );
+}
+
+TYCHE_TEST(liquidate_same_token_pays_once) {
+   market_tester t;
+   REQUIRE_OK( t.transfer_in("bob"_n, asset(2'00000000, ETH), "supply") );
+   REQUIRE_OK( t.transfer_in("alice"_n, asset(2'00000000, ETH), "supply") );
+   REQUIRE_OK( t.push({"bob"_n}, [](auto& c) { c.setcollat("bob"_n, ETH.code(), true); }) );
+   REQUIRE_OK( t.borrow("bob"_n, asset(1'00000000, ETH)) );
+
+   //close factor 50%: 还 0.5 ETH, 退回 0.5 ETH, 扣走 0.5 x 110% = 0.55 ETH; 退款与扣押合并为一笔
+   auto res = t.transfer_in("carol"_n, asset(1'00000000, ETH), "liquidate:bob:ETH:ETH");
+   REQUIRE_OK( res );
+   REQUIRE_EQ( res.inline_actions.size(), 1u );
+   REQUIRE_EQ( name(res.inline_actions[0].account), BANK );
+   auto payout = action_data<transfer_args>(res.inline_actions[0]);
+   REQUIRE_EQ( payout.to, "carol"_n );
+   REQUIRE_EQ( payout.quantity, asset(1'05000000, ETH) );
+   REQUIRE_EQ( payout.memo, std::string("liquidate refund|liquidate seize") );
+}
@@ -75,8 +75,13 @@ mpush flon.mtoken transfer '["flonian","tycreward111","1000.000000 USDT","intere
 #用户提取奖励/利息
 mpush tyche.earn11 claimrewards '["flonian"]' -p flonian
 mpush tyche.earn11 claimreward '["flonian","6,USDT"]' -p flonian
+#池子较多时单次只领取部分池子, 进度记录在 contcursor, 再次调用继续领取
+mcli get table tyche.earn11 flonian contcursor
+#开启利息自动复投: 之后存款/领取时结算的利息计入本金, 并发放等额 TRUSD
+mpush tyche.earn11 setcompound '["flonian",true]' -p flonian
 
 mpush tyche.token transfer '["flonian","tyche.earn11","100.000000 TRUSD","redeem:1"]' -p flonian   #用户取回本金（用户操作）
+mpush tyche.token transfer '["flonian","tyche.earn11","300.000000 TRUSD","redeem:2,3"]' -p flonian #一次赎回多个池子, 金额为各池本金之和
 
 
 #loan初始化
@@ -113,6 +118,10 @@ mpush flon.mtoken transfer '["gahbnbehaskk","tyche.loan11","0.100000 USDT","send
 mpush tyche.loan11 onsubcallat '["gahbnbehaskk","0.00001000 BTC"]' -p gahbnbehaskk
 
 #清算操作
+#旧版本 loaners 行写回为最新版本, 返回值非空时以其为 start 继续
+mpush tyche.loan11 migraterows '["8,BTC","",100]' -p flonian
+#利率历史过长时分批结算旧仓位利息, 直到写入 settled_index
+mpush tyche.loan11 settlehist '["8,BTC","gahbnbehaskk"]' -p flonian
 #普通清算
 
 mpush flon.mtoken transfer '["gahbnbehaskk","tyche.loan11","0.020000 USDT","liqbuy:8,BTC:gahbnbehaskk"]' -p gahbnbehaskk
@@ -122,6 +131,18 @@ mpush tyche.loan11 forceliq '["system","gahbnbehaskk","8,BTC"]' -p system
 #Loan 把资金返还给 Earn
 mpush tyche.loan11 sendtoearn '["1000.000000 USDT"]' -p tyche.loan11
 
+#earn/loan 资金调拨
+#loan 账户新建 rebalance 权限授予 earn@eosio.code, 并只关联 sendtoearn
+mcli set account permission tyche.loan11 rebalance '{"threshold":1,"keys":[],"accounts":[{"permission":{"actor":"tyche.earn11","permission":"eosio.code"},"weight":1}]}' active -p tyche.loan11
+mcli set action permission tyche.loan11 tyche.loan11 sendtoearn rebalance -p tyche.loan11
+mpush tyche.earn11 setrebalconf '[{"keeper":"flonian","loan_contract":"tyche.loan11","loan_permission":"rebalance","horizon_days":7,"earn_buffer_ratio":1000,"loan_min_idle_ratio":1000,"loan_max_idle_ratio":3000,"min_transfer_quant":"100.000000 USDT"}]' -p tyche.earn11
+#升级后按池子补建到期本金汇总, 每个池子执行一次
+mpush tyche.earn11 initmaturity '[1,"",100]' -p tyche.earn11
+#升级后旧版本 earnpools/earners 行写回为最新版本, 每个池子执行至 maintcursor 中无 migrate 记录
+mpush tyche.earn11 migraterows '[1,"",100]' -p tyche.earn11
+mcli get table tyche.earn11 1 maintcursor
+mpush tyche.earn11 rebalance '["flonian"]' -p flonian
+
 
 
 
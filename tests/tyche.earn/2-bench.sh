@@ -0,0 +1,35 @@
+#存款/领取 CPU 随奖励币种数量增长的基准
+#前置: 已执行 1-tests.sh (tyche.earn11 / tycreward111 已部署并初始化, 池子 1 已设置)
+#输出: 奖励币种数  存款cpu(us)  领取cpu(us)
+
+tyche_earn=tyche.earn11
+tyche_reward=tycreward111
+bench_token=benchtoken11
+user=flonian
+letters=ABCDEFGHIJKLMNOP
+
+mreg flon $bench_token flonian
+mtran flonian $bench_token "100 FLON"
+mset $bench_token flon.token
+
+cpu_us() {
+   mcli push action "$@" -j | jq -r '.processed.receipt.cpu_usage_us'
+}
+
+added=0
+printf "%-8s %-12s %-12s\n" symbols deposit_us claim_us
+for n in 1 2 4 8 16; do
+   #补足 n 个奖励币, 每个币都向所有池子打入一次奖励
+   while [ $added -lt $n ]; do
+      sym="BN${letters:$added:1}"
+      mpush $bench_token create '["flonian","1000000000.0000 '$sym'"]' -p $bench_token
+      mpush $bench_token issue '["flonian","1000000.0000 '$sym'","bench"]' -p flonian
+      mpush $tyche_earn addrewardsym '{"sym":{ "sym":"4,'$sym'", "contract":"'$bench_token'" }}' -p $tyche_earn
+      mpush $bench_token transfer '["flonian","'$tyche_reward'","100.0000 '$sym'","reward:0"]' -p flonian
+      added=$((added+1))
+   done
+
+   deposit=$(cpu_us flon.mtoken transfer '["'$user'","'$tyche_earn'","1.000000 USDT","deposit:1"]' -p $user)
+   claim=$(cpu_us $tyche_earn claimrewards '["'$user'"]' -p $user)
+   printf "%-8s %-12s %-12s\n" $n $deposit $claim
+done
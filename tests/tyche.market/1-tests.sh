@@ -55,6 +55,8 @@ mpush $tyche_market addreserve '[{"sym":"8,ETH","contract":"flon.mtoken"},7500,8
 # ]' -p flonian
 
 mpush $tyche_market addreserve '[{"sym":"6,USDT","contract":"flon.mtoken"},0, 0,10500, 1000,8000,200,600,2000 ]' -p flonian
+#旧版本 reserves / 用户 positions 行写回为最新版本, 返回值非空时以其为 start 继续
+mpush $tyche_market migraterows '["","",100]' -p flonian
 #修改 USDT 池参数测试
 #mpush $tyche_market setreserve '["USDT",0,0,10500,1000]' -p flonian
 